@@ -0,0 +1,152 @@
+#include <framegenerator.h>
+
+/* 
+ * The constructor instanciate a generator for frames with the given
+ * number of channels. The same seed always gives the same frames.
+ */
+FrameGenerator::FrameGenerator(int channels, uint32_t seed)
+    : random(seed)
+{
+    channelCount = channels;
+}
+
+/*
+ * Generate a single frame with random weights. With negative set,
+ * one channel is sent as an uncalibrated scale, e.g. "- 1234".
+ */
+std::string FrameGenerator::Frame(bool negative)
+{
+    std::uniform_int_distribution<int> weights(0, 99999);
+    std::uniform_int_distribution<int> negativeChannel(0, channelCount - 1);
+    int negativeIndx = negative ? negativeChannel(random) : -1;
+
+    std::vector<int> channelWeights(channelCount);
+    for (int indx = 0; indx < channelCount; indx++)
+        channelWeights[indx] = indx == negativeIndx ? -(weights(random) % 10000) : weights(random);
+
+    return Frame(channelWeights);
+}
+
+/*
+ * Generate a single frame with the given weights, one per channel,
+ * followed by their TOTAL.
+ */
+std::string FrameGenerator::Frame(const std::vector<int>& weights)
+{
+    std::string frame = "/\r\n";
+    int total = 0;
+
+    for (size_t indx = 0; indx < weights.size(); indx++)
+    {
+        char name[2] = {char('A' + indx), 0};
+        AppendWeight(frame, name, weights[indx]);
+        total += weights[indx];
+    }
+
+    AppendWeight(frame, "TOTAL", total);
+    frame += "\\\r\n";
+
+    return frame;
+}
+
+/*
+ * One frame per read.
+ */
+FrameStream FrameGenerator::WholeFrames(size_t frameCount, bool negative)
+{
+    FrameStream stream = {{}, frameCount, 0};
+
+    for (size_t indx = 0; indx < frameCount; indx++)
+    {
+        stream.chunks.push_back(Frame(negative));
+        stream.bytes += stream.chunks.back().size();
+    }
+
+    return stream;
+}
+
+/*
+ * Every frame is split over several reads at random points.
+ */
+FrameStream FrameGenerator::SplitFrames(size_t frameCount)
+{
+    FrameStream stream = {{}, frameCount, 0};
+    std::uniform_int_distribution<size_t> splitSize(1, 32);
+
+    for (size_t indx = 0; indx < frameCount; indx++)
+    {
+        std::string frame = Frame(false);
+        stream.bytes += frame.size();
+
+        for (size_t pos = 0; pos < frame.size();)
+        {
+            size_t size = splitSize(random);
+            stream.chunks.push_back(frame.substr(pos, size));
+            pos += size;
+        }
+    }
+
+    return stream;
+}
+
+/*
+ * Several frames arrive in a single read.
+ */
+FrameStream FrameGenerator::GluedFrames(size_t frameCount, size_t framesPerRead)
+{
+    FrameStream stream = {{}, frameCount, 0};
+
+    for (size_t indx = 0; indx < frameCount; indx++)
+    {
+        if (indx % framesPerRead == 0) stream.chunks.emplace_back();
+
+        stream.chunks.back() += Frame(false);
+    }
+
+    for (std::string& chunk : stream.chunks) stream.bytes += chunk.size();
+
+    return stream;
+}
+
+/*
+ * Every other frame is corrupted: cut short without its closing
+ * character, or with garbage in front of it. Frames cut short are
+ * not counted, garbage is purged so those frames still are.
+ */
+FrameStream FrameGenerator::CorruptedFrames(size_t frameCount)
+{
+    FrameStream stream = {{}, 0, 0};
+
+    for (size_t indx = 0; indx < frameCount; indx++)
+    {
+        std::string frame = Frame(false);
+
+        if (indx % 4 == 1)
+            frame.erase(frame.size() / 2);
+        else if (indx % 4 == 3)
+            frame.insert(0, "\x7f\x03garbage 12 Kg\r\n");
+
+        if (indx % 4 != 1) stream.frames++;
+        stream.bytes += frame.size();
+        stream.chunks.push_back(frame);
+    }
+
+    return stream;
+}
+
+/*
+ * Append a weight line as sent by the scales: the name padded to
+ * five characters and the weight right aligned to six, with a space
+ * between the sign and the digits of short negative numbers.
+ */
+void FrameGenerator::AppendWeight(std::string& frame, const char* name, int weight)
+{
+    char line[32];
+
+    if (weight < 0 && weight > -10000)
+        snprintf(line, sizeof(line), "%-5s: -%5d Kg\r\n", name, -weight);
+    else
+        snprintf(line, sizeof(line), "%-5s: %6d Kg\r\n", name, weight);
+
+    frame += line;
+}
@@ -0,0 +1,50 @@
+#ifndef FRAMEGENERATOR_H
+#define FRAMEGENERATOR_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <random>
+
+/*
+ * A stream of serial data as it would be returned by successive reads,
+ * and the number of well formed frames it holds.
+ */
+struct FrameStream
+{
+    std::vector<std::string>    chunks;
+    size_t                      frames;
+    size_t                      bytes;
+};
+
+/*
+ * Generates synthetic Pacific Scales frames in the same layout as the
+ * simulator, and streams made from them with the faults seen on a real line.
+ */
+class FrameGenerator
+{
+    public:
+        // --------------- Public Attributes ---------------- //
+
+        // ----------------- Public Methods ----------------- //
+        FrameGenerator(int channels, uint32_t seed);
+
+        std::string                 Frame(bool negative);
+        std::string                 Frame(const std::vector<int>& weights);
+
+        FrameStream                 WholeFrames(size_t frameCount, bool negative);
+        FrameStream                 SplitFrames(size_t frameCount);
+        FrameStream                 GluedFrames(size_t frameCount, size_t framesPerRead);
+        FrameStream                 CorruptedFrames(size_t frameCount);
+
+    private:
+        // --------------- Private Attributes --------------- //
+        int                         channelCount;
+        std::mt19937                random;
+
+        // ----------------- Private Methods ---------------- //
+        void                        AppendWeight(std::string& frame, const char* name, int weight);
+};
+
+#endif
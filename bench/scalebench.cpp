@@ -0,0 +1,536 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#include <zlib.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+#include <scaleparser.h>
+#include <readingformat.h>
+#include <readingarchive.h>
+#include <framegenerator.h>
+
+// Number of frames in each generated stream
+#define BENCH_FRAME_COUNT   1000
+// Number of readings archived, about 4.5 hours of the scales' 2s period
+#define BENCH_ARCHIVE_COUNT 8192
+
+// Decoded weights are summed into here, so decoding cannot be optimised out
+static volatile int64_t weightSink = 0;
+
+// Every allocation made through operator new is counted
+static uint64_t allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    void* memory = malloc(size ? size : 1);
+    if (memory == NULL) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+
+/*
+ * A stream buffer which discards everything, so printing can be
+ * measured without the cost of the terminal.
+ */
+class NullBuffer : public std::streambuf
+{
+    protected:
+        int                 overflow(int c) override { return c; }
+        std::streamsize     xsputn(const char*, std::streamsize size) override { return size; }
+};
+
+struct BenchResult
+{
+    std::string             name;
+    size_t                  frames;
+    double                  nsPerFrame;
+    double                  allocsPerFrame;
+    double                  bytesPerSecond;
+};
+
+struct ArchiveSize
+{
+    std::string             name;
+    size_t                  readings;
+    size_t                  ndjsonBytes;
+    size_t                  gzipBytes;
+    size_t                  archiveBytes;
+};
+
+/*
+ * Run the body repeatedly for at least the minimum time, once beforehand
+ * to warm up. The body handles the given number of frames and bytes
+ * on every run.
+ */
+template <typename Body>
+BenchResult RunBench(std::string name, size_t frames, size_t bytes, double minTimeMs, Body body)
+{
+    body();
+
+    size_t runs = 0;
+    uint64_t startAllocations = allocationCount;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed;
+
+    do
+    {
+        body();
+        runs++;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < minTimeMs * 1e6);
+
+    double totalFrames = double(runs) * frames;
+    BenchResult result;
+    result.name = name;
+    result.frames = frames;
+    result.nsPerFrame = elapsed.count() / totalFrames;
+    result.allocsPerFrame = (allocationCount - startAllocations) / totalFrames;
+    result.bytesPerSecond = double(runs) * bytes / (elapsed.count() / 1e9);
+
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1);
+    std::cout << std::setw(12) << result.nsPerFrame << " ns/frame";
+    std::cout << std::setw(10) << std::setprecision(2) << result.allocsPerFrame << " allocs/frame";
+    std::cout << std::setw(10) << std::setprecision(1) << result.bytesPerSecond / 1e6 << " MB/s" << std::endl;
+
+    return result;
+}
+
+/*
+ * Make sure a stage saw the frames the generator says it holds, so a
+ * broken stage cannot look fast.
+ */
+void CheckFrames(std::string name, size_t seen, size_t expected)
+{
+    if (seen == expected) return;
+
+    std::string errMsg = ErrorMsg(EINVAL, name + " saw " + std::to_string(seen) + " frames, expected " + std::to_string(expected));
+    throw std::runtime_error(errMsg);
+}
+
+/*
+ * Benchmark the framer on a stream of reads.
+ */
+BenchResult BenchFramer(std::string name, const FrameStream& stream, double minTimeMs)
+{
+    size_t framesSeen = 0;
+    ScaleFramer framer([&](const char*, size_t){ framesSeen++; });
+
+    BenchResult result = RunBench(name, stream.frames, stream.bytes, minTimeMs, [&]()
+    {
+        framesSeen = 0;
+        for (const std::string& chunk : stream.chunks) framer.Feed(chunk.data(), chunk.size());
+    });
+
+    CheckFrames(name, framesSeen, stream.frames);
+    return result;
+}
+
+/*
+ * Benchmark splitting and parsing whole frames into readings.
+ */
+BenchResult BenchParser(std::string name, const FrameStream& stream, double minTimeMs)
+{
+    ScaleReadingParser readingParser;
+    ScaleReading reading;
+    size_t framesSeen = 0;
+
+    BenchResult result = RunBench(name, stream.frames, stream.bytes, minTimeMs, [&]()
+    {
+        framesSeen = 0;
+        for (const std::string& frame : stream.chunks)
+            framesSeen += readingParser.Parse(frame.data(), frame.size(), reading);
+    });
+
+    CheckFrames(name, framesSeen, stream.frames);
+    return result;
+}
+
+/*
+ * Benchmark the whole library path, reads pushed in and readings out.
+ */
+BenchResult BenchPipeline(std::string name, const FrameStream& stream, double minTimeMs)
+{
+    size_t framesSeen = 0;
+    ScaleParser scaleParser([&](const ScaleReading&){ framesSeen++; });
+
+    BenchResult result = RunBench(name, stream.frames, stream.bytes, minTimeMs, [&]()
+    {
+        framesSeen = 0;
+        for (const std::string& chunk : stream.chunks) scaleParser.Push(chunk.data(), chunk.size());
+    });
+
+    CheckFrames(name, framesSeen, stream.frames);
+    return result;
+}
+
+/*
+ * Benchmark the output stages on readings parsed from a stream: the
+ * JSON conversion alone, and the full snapshot printed on a boundary.
+ */
+void BenchOutput(std::string suffix, const FrameStream& stream, double minTimeMs, std::vector<BenchResult>& results)
+{
+    ScaleReadingParser readingParser;
+    std::vector<ScaleReading> readings(stream.chunks.size());
+    for (size_t indx = 0; indx < stream.chunks.size(); indx++)
+        readingParser.Parse(stream.chunks[indx].data(), stream.chunks[indx].size(), readings[indx]);
+
+    time_t now = time(NULL);
+    tm nowLocal;
+    localtime_r(&now, &nowLocal);
+
+    NullBuffer nullBuffer;
+    std::ostream nullOut(&nullBuffer);
+    size_t outputBytes = 0;
+
+    results.push_back(RunBench("json/" + suffix, readings.size(), stream.bytes, minTimeMs, [&]()
+    {
+        char jsonChar[READING_JSON_SIZE];
+        for (const ScaleReading& reading : readings) outputBytes += FormatReadingJson(reading, jsonChar, sizeof(jsonChar));
+    }));
+
+    results.push_back(RunBench("snapshot/" + suffix, readings.size(), stream.bytes, minTimeMs, [&]()
+    {
+        for (const ScaleReading& reading : readings) WriteSnapshot(nullOut, reading, &nowLocal);
+    }));
+}
+
+/*
+ * Readings as a scale sends them over time: every 2s give or take a few
+ * milliseconds, with weights that mostly hold, now and then settle by a
+ * little and once in a while change completely as a load comes or goes.
+ */
+std::vector<ScaleReading> SettlingReadings(FrameGenerator& generator, int channels, size_t readingCount, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> weight(0, 99999);
+    std::uniform_int_distribution<int> settle(-500, 500);
+    std::uniform_int_distribution<int> jitterMs(-20, 20);
+    std::uniform_int_distribution<int> chance(0, 999);
+
+    std::vector<int> weights(channels);
+    for (int& channelWeight : weights) channelWeight = weight(random);
+
+    ScaleReadingParser readingParser;
+    std::vector<ScaleReading> readings(readingCount);
+    std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+
+    for (size_t indx = 0; indx < readingCount; indx++)
+    {
+        for (int& channelWeight : weights)
+        {
+            int roll = chance(random);
+            if (roll < 5) channelWeight = weight(random);
+            else if (roll < 100) channelWeight = std::max(channelWeight + settle(random), 0);
+        }
+
+        std::string frame = generator.Frame(weights);
+        readingParser.Parse(frame.data(), frame.size(), readings[indx]);
+        readings[indx].timestamp = start + std::chrono::milliseconds(2000 * indx + jitterMs(random));
+    }
+
+    return readings;
+}
+
+/*
+ * Make sure a reading came back from the archive as it went in.
+ */
+void CheckArchived(const ScaleReading& original, const ScaleReading& archived)
+{
+    bool same = original.channelCount == archived.channelCount && original.hasTotal == archived.hasTotal &&
+                original.valid == archived.valid && original.total.rawValue == archived.total.rawValue &&
+                std::chrono::time_point_cast<std::chrono::milliseconds>(original.timestamp) == archived.timestamp;
+
+    for (int indx = 0; same && indx < original.channelCount; indx++)
+    {
+        same = original.channels[indx].rawValue == archived.channels[indx].rawValue &&
+               std::strcmp(original.channels[indx].name, archived.channels[indx].name) == 0 &&
+               std::strcmp(original.channels[indx].unit, archived.channels[indx].unit) == 0;
+    }
+
+    if (same) return;
+
+    std::string errMsg = ErrorMsg(EINVAL, "archive returned a different reading");
+    throw std::runtime_error(errMsg);
+}
+
+/*
+ * Compress data with gzip in one go, or decompress it into the given size.
+ */
+std::string Gzip(const std::string& data)
+{
+    z_stream stream = {};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+
+    std::string compressed(deflateBound(&stream, data.size()), 0);
+    stream.next_in = (Bytef*)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef*)&compressed[0];
+    stream.avail_out = compressed.size();
+    deflate(&stream, Z_FINISH);
+
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return compressed;
+}
+
+std::string Gunzip(const std::string& data, size_t size)
+{
+    z_stream stream = {};
+    inflateInit2(&stream, 15 + 16);
+
+    std::string decompressed(size, 0);
+    stream.next_in = (Bytef*)data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef*)&decompressed[0];
+    stream.avail_out = decompressed.size();
+    inflate(&stream, Z_FINISH);
+
+    decompressed.resize(stream.total_out);
+    inflateEnd(&stream);
+    return decompressed;
+}
+
+/*
+ * Benchmark keeping readings in the archive against keeping them as
+ * gzipped lines of JSON, the reading with its time in milliseconds.
+ * Both are written and read back into weights, and their sizes kept.
+ */
+void BenchArchive(std::string suffix, int channels, double minTimeMs, std::vector<BenchResult>& results, std::vector<ArchiveSize>& sizes)
+{
+    FrameGenerator generator(channels, channels);
+    std::vector<ScaleReading> readings = SettlingReadings(generator, channels, BENCH_ARCHIVE_COUNT, channels);
+
+    // The same readings as lines of JSON
+    std::string ndjson;
+    char jsonChar[READING_JSON_SIZE];
+    for (const ScaleReading& reading : readings)
+    {
+        FormatReadingJson(reading, jsonChar, sizeof(jsonChar));
+        int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(reading.timestamp.time_since_epoch()).count();
+        ndjson += "{\"TIME\":" + std::to_string(timeMs) + ",\"READING\":" + jsonChar + "}\n";
+    }
+
+    std::string archivePath = "/tmp/scalebench_" + std::to_string(getpid()) + ".scar";
+    unlink(archivePath.c_str());
+    {
+        ReadingArchiveWriter archiveWriter(archivePath.c_str());
+        for (const ScaleReading& reading : readings) archiveWriter.Append(reading);
+        archiveWriter.Flush();
+        sizes.push_back({"archive/" + suffix, readings.size(), ndjson.size(), Gzip(ndjson).size(), archiveWriter.BytesWritten()});
+    }
+
+    // Make sure everything comes back before timing it
+    {
+        ReadingArchiveReader archiveReader(archivePath.c_str());
+        ScaleReading archived;
+        size_t row = 0;
+        while (archiveReader.NextBlock())
+        {
+            archiveReader.DecodeBlock();
+            for (size_t indx = 0; indx < archiveReader.Header().readingCount; indx++, row++)
+            {
+                archiveReader.Reading(indx, archived);
+                CheckArchived(readings[row], archived);
+            }
+        }
+        CheckFrames("archive/" + suffix, row, readings.size());
+    }
+
+    ReadingArchiveWriter nullWriter("/dev/null");
+    results.push_back(RunBench("archive/encode/" + suffix, readings.size(), ndjson.size(), minTimeMs, [&]()
+    {
+        for (const ScaleReading& reading : readings) nullWriter.Append(reading);
+        nullWriter.Flush();
+    }));
+
+    int64_t weightSum = 0;
+    results.push_back(RunBench("archive/decode/" + suffix, readings.size(), ndjson.size(), minTimeMs, [&]()
+    {
+        ReadingArchiveReader archiveReader(archivePath.c_str());
+        while (archiveReader.NextBlock())
+        {
+            archiveReader.DecodeBlock();
+            const ArchiveBlockHeader& header = archiveReader.Header();
+            for (size_t column = 0; column < size_t(header.channelCount + header.hasTotal); column++)
+            {
+                const int32_t* weights = archiveReader.Weights(column);
+                for (size_t row = 0; row < header.readingCount; row++) weightSum += weights[row];
+            }
+        }
+    }));
+
+    unlink(archivePath.c_str());
+
+    std::string gzipped;
+    results.push_back(RunBench("ndjson-gzip/encode/" + suffix, readings.size(), ndjson.size(), minTimeMs, [&]()
+    {
+        std::string lines;
+        for (const ScaleReading& reading : readings)
+        {
+            FormatReadingJson(reading, jsonChar, sizeof(jsonChar));
+            int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(reading.timestamp.time_since_epoch()).count();
+            lines += "{\"TIME\":" + std::to_string(timeMs) + ",\"READING\":" + jsonChar + "}\n";
+        }
+        gzipped = Gzip(lines);
+    }));
+
+    results.push_back(RunBench("ndjson-gzip/inflate/" + suffix, readings.size(), ndjson.size(), minTimeMs, [&]()
+    {
+        weightSum += Gunzip(gzipped, ndjson.size()).size();
+    }));
+
+    size_t linesSeen = 0;
+    results.push_back(RunBench("ndjson-gzip/decode/" + suffix, readings.size(), ndjson.size(), minTimeMs, [&]()
+    {
+        std::string lines = Gunzip(gzipped, ndjson.size());
+        std::stringstream lineStream(lines);
+        std::string line;
+        linesSeen = 0;
+
+        while (std::getline(lineStream, line))
+        {
+            nlohmann::json reading = nlohmann::json::parse(line)["READING"];
+            for (auto& entry : reading.items())
+                if (entry.value().is_object()) weightSum += entry.value()["VALUE"].get<int64_t>();
+            linesSeen++;
+        }
+    }));
+
+    CheckFrames("ndjson-gzip/decode/" + suffix, linesSeen, readings.size());
+    weightSink = weightSum;
+}
+
+void PrintHelp()
+{
+    std::cout << "Microbenchmarks for the scale data parsing stages" << std::endl;
+    std::cout << "Usage: scalebench [-h|--help]" << std::endl;
+    std::cout << "                  [-o|--output <path> [default: bench_results.json]]" << std::endl;
+    std::cout << "                  [-t|--time <ms per benchmark> [default: 200]]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string outputPath = "bench_results.json";
+    double minTimeMs = 200;
+
+    // Loop through all the command line arguments
+    for (int indx = 1; indx < argc; indx++)
+    {
+        std::string currentArg = std::string(argv[indx]);
+
+        if (currentArg == "-h" || currentArg == "--help")
+        {
+            PrintHelp();
+            return 0;
+        }
+        else if ((currentArg == "-o" || currentArg == "--output") && indx + 1 <= argc-1)
+            outputPath = std::string(argv[++indx]);
+        else if ((currentArg == "-t" || currentArg == "--time") && indx + 1 <= argc-1)
+            minTimeMs = atof(argv[++indx]);
+        else
+        {
+            std::cout << "Error: Unknown or incomplete argument: " << currentArg << std::endl;
+            PrintHelp();
+            return -1;
+        }
+    }
+
+    try
+    {
+        std::vector<BenchResult> results;
+        std::vector<ArchiveSize> sizes;
+
+        for (int channels : {4, 6, 8})
+        {
+            std::string suffix = std::to_string(channels) + "ch";
+            FrameGenerator generator(channels, channels);
+
+            FrameStream whole = generator.WholeFrames(BENCH_FRAME_COUNT, false);
+            FrameStream negative = generator.WholeFrames(BENCH_FRAME_COUNT, true);
+            FrameStream split = generator.SplitFrames(BENCH_FRAME_COUNT);
+            FrameStream glued = generator.GluedFrames(BENCH_FRAME_COUNT, 8);
+            FrameStream corrupted = generator.CorruptedFrames(BENCH_FRAME_COUNT);
+
+            results.push_back(BenchFramer("framer/whole/" + suffix, whole, minTimeMs));
+            results.push_back(BenchFramer("framer/split/" + suffix, split, minTimeMs));
+            results.push_back(BenchFramer("framer/glued/" + suffix, glued, minTimeMs));
+            results.push_back(BenchFramer("framer/corrupted/" + suffix, corrupted, minTimeMs));
+
+            results.push_back(BenchParser("parser/whole/" + suffix, whole, minTimeMs));
+            results.push_back(BenchParser("parser/negative/" + suffix, negative, minTimeMs));
+
+            BenchOutput(suffix, whole, minTimeMs, results);
+
+            results.push_back(BenchPipeline("pipeline/split/" + suffix, split, minTimeMs));
+            results.push_back(BenchPipeline("pipeline/glued/" + suffix, glued, minTimeMs));
+
+            BenchArchive(suffix, channels, minTimeMs, results, sizes);
+        }
+
+        // Storage used by each reading, kept as an archive and as gzipped JSON lines
+        for (ArchiveSize& size : sizes)
+        {
+            std::cout << std::left << std::setw(28) << size.name << std::right << std::fixed << std::setprecision(1);
+            std::cout << std::setw(8) << double(size.archiveBytes) / size.readings << " B/reading | ndjson+gzip ";
+            std::cout << double(size.gzipBytes) / size.readings << " B/reading | ndjson " << double(size.ndjsonBytes) / size.readings;
+            std::cout << " B/reading | " << double(size.gzipBytes) / size.archiveBytes << "x smaller than ndjson+gzip" << std::endl;
+        }
+
+        // Save the results for tracking over time
+        nlohmann::json output;
+        output["timestamp"] = time(NULL);
+        output["min_time_ms"] = minTimeMs;
+        output["benchmarks"] = nlohmann::json::array();
+
+        for (BenchResult& result : results)
+        {
+            output["benchmarks"].push_back({
+                {"name", result.name},
+                {"frames", result.frames},
+                {"ns_per_frame", result.nsPerFrame},
+                {"allocs_per_frame", result.allocsPerFrame},
+                {"bytes_per_second", result.bytesPerSecond}
+            });
+        }
+
+        output["archive_sizes"] = nlohmann::json::array();
+        for (ArchiveSize& size : sizes)
+        {
+            output["archive_sizes"].push_back({
+                {"name", size.name},
+                {"readings", size.readings},
+                {"ndjson_bytes", size.ndjsonBytes},
+                {"ndjson_gzip_bytes", size.gzipBytes},
+                {"archive_bytes", size.archiveBytes}
+            });
+        }
+
+        std::ofstream outputFile(outputPath);
+        if (!outputFile)
+        {
+            std::string errMsg = ErrorMsg(errno, "Failed to open the output file: " + outputPath);
+            throw std::runtime_error(errMsg);
+        }
+        outputFile << output.dump(4) << std::endl;
+        std::cout << "Results saved to " << outputPath << std::endl;
+
+        return 0;
+    }
+
+    catch(std::runtime_error e)
+    {
+        std::cout << e.what() << std::endl;
+        return -1;
+    }
+}
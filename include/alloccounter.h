@@ -0,0 +1,20 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+/*
+ * Allocation check build only. Every operator new is counted so a test
+ * run can tell whether the heap is used once the parser has warmed up.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+uint64_t AllocationCount();
+long ResidentSetKb();
+
+#endif
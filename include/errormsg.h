@@ -0,0 +1,10 @@
+#ifndef ERRORMSG_H
+#define ERRORMSG_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+std::string ErrorMsg(int8_t errorNo, std::string msg);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PORTWATCHER_H
+#define PORTWATCHER_H
+
+/*
+ * Watches the directory of a serial port with inotify, so that a port
+ * which went away can be reopened as soon as it is created again, e.g.
+ * when a USB serial adapter is plugged back in, without polling for it.
+ */
+
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "errormsg.h"
+
+class PortWatcher
+{
+    public:
+        // --------------- Public Attributes ---------------- //
+
+        // ----------------- Public Methods ----------------- //
+        PortWatcher(const char* portPath);
+        ~PortWatcher();
+
+        bool                        WaitForPort(int timeoutMs);
+        bool                        PortChanged();
+
+        // Return attribute methods
+        int32_t                     Descriptor(){ return watchFile; };
+
+    private:
+        // --------------- Private Attributes --------------- //
+        int32_t                     watchFile;
+        int32_t                     directoryWatch;
+        std::string                 portDirectory;
+        std::string                 portName;
+
+        // ----------------- Private Methods ---------------- //
+        bool                        WatchDirectory();
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef READINGARCHIVE_H
+#define READINGARCHIVE_H
+
+/*
+ * Compact archive of readings for long term retention. Readings are grouped
+ * into blocks and each block is stored column by column: the timestamps,
+ * each channel, the TOTAL and the VALID bits. Timestamps are kept in
+ * milliseconds as zigzag varints of their delta-of-delta, after the first
+ * which is kept whole, and weights as zigzag varints of their delta to the
+ * previous reading. As weights mostly hold, a weight column is the number
+ * of readings a weight held as a varint before each delta, ending with the
+ * readings it held until the end of the block. Every block starts with a
+ * header holding its time range and the min/max of each column, so a scan
+ * can skip blocks without decoding them.
+ *
+ * File layout, all integers little endian:
+ *   "SCAR" version(1) reserved(3)
+ *   block: "SCBK" headerSize(4) header payload
+ *   header: readingCount(4) minTimeMs(8) maxTimeMs(8) channelCount(1)
+ *           hasTotal(1) payloadSize(4), then per weight column nameSize(1)
+ *           name unitSize(1) unit min(4) max(4), then the size of every
+ *           column(4): timestamps, weights, VALID bits
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "scalereading.h"
+#include "errormsg.h"
+
+// Readings per block, about 34 minutes of the scales' 2s period
+#define ARCHIVE_BLOCK_READINGS  1024
+// Most readings a block may hold, so a reader can trust the count
+#define ARCHIVE_MAX_READINGS    65536
+#define ARCHIVE_VERSION         1
+
+// Weight columns in a block, every channel and the TOTAL
+#define ARCHIVE_MAX_COLUMNS     (SCALE_MAX_CHANNELS + 1)
+
+/*
+ * A weight column of a block, its name, unit and range. The range is
+ * over the weights as sent, negative weights included.
+ */
+struct ArchiveColumn
+{
+    char                        name[SCALE_NAME_SIZE];
+    char                        unit[SCALE_UNIT_SIZE];
+    int32_t                     minValue;
+    int32_t                     maxValue;
+};
+
+/*
+ * Header of a block, enough to decide whether it is worth decoding.
+ * The TOTAL, if any, is the last column.
+ */
+struct ArchiveBlockHeader
+{
+    uint32_t                    readingCount;
+    int64_t                     minTimeMs;
+    int64_t                     maxTimeMs;
+    uint8_t                     channelCount;
+    bool                        hasTotal;
+    uint32_t                    payloadSize;
+    ArchiveColumn               columns[ARCHIVE_MAX_COLUMNS];
+    uint32_t                    columnSizes[ARCHIVE_MAX_COLUMNS + 2];
+};
+
+class ReadingArchiveWriter
+{
+    public:
+        // --------------- Public Attributes ---------------- //
+
+        // ----------------- Public Methods ----------------- //
+        ReadingArchiveWriter(const char* archivePath, uint32_t blockSize = ARCHIVE_BLOCK_READINGS);
+        ~ReadingArchiveWriter();
+
+        void                        Append(const ScaleReading& reading);
+        void                        Flush();
+
+        // Return attribute methods
+        uint64_t                    ReadingsWritten(){ return readingsWritten; };
+        uint64_t                    BytesWritten(){ return bytesWritten; };
+
+    private:
+        // --------------- Private Attributes --------------- //
+        int32_t                     archiveFile;
+        uint32_t                    blockReadings;
+
+        // The block being filled, its columns are allocated up front
+        ArchiveBlockHeader          header;
+        std::vector<uint8_t>        timeColumn;
+        std::vector<uint8_t>        weightColumns[ARCHIVE_MAX_COLUMNS];
+        std::vector<uint8_t>        validColumn;
+        int64_t                     lastTimeMs;
+        int64_t                     lastDeltaMs;
+        int32_t                     lastWeights[ARCHIVE_MAX_COLUMNS];
+        uint32_t                    unchangedWeights[ARCHIVE_MAX_COLUMNS];
+
+        uint64_t                    readingsWritten;
+        uint64_t                    bytesWritten;
+
+        // ----------------- Private Methods ---------------- //
+        void                        OpenArchive(const char* archivePath);
+        bool                        SameLayout(const ScaleReading& reading);
+        void                        StartBlock(const ScaleReading& reading);
+        void                        WriteBlock();
+};
+
+class ReadingArchiveReader
+{
+    public:
+        // --------------- Public Attributes ---------------- //
+
+        // ----------------- Public Methods ----------------- //
+        ReadingArchiveReader(const char* archivePath);
+        ~ReadingArchiveReader();
+
+        bool                        NextBlock();
+        void                        DecodeBlock();
+        void                        Reading(size_t row, ScaleReading& reading);
+
+        // Return attribute methods
+        const ArchiveBlockHeader&   Header(){ return header; };
+        const int64_t*              Timestamps(){ return timestamps.data(); };
+        const int32_t*              Weights(size_t column){ return weights.data() + column * header.readingCount; };
+        bool                        Valid(size_t row){ return (validBits[row / 8] >> (row % 8)) & 1; };
+
+    private:
+        // --------------- Private Attributes --------------- //
+        int32_t                     archiveFile;
+
+        // The current block, decoded in place
+        ArchiveBlockHeader          header;
+        bool                        payloadRead;
+        std::vector<uint8_t>        payload;
+        std::vector<uint64_t>       varints;
+        std::vector<int64_t>        timestamps;
+        std::vector<int32_t>        weights;
+        std::vector<uint8_t>        validBits;
+
+        // ----------------- Private Methods ---------------- //
+        void                        ReadPayload();
+};
+
+bool ReadBlockHeader(int32_t archiveFile, ArchiveBlockHeader& header);
+
+#endif
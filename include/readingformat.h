@@ -0,0 +1,19 @@
+#ifndef READINGFORMAT_H
+#define READINGFORMAT_H
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdarg>
+#include <algorithm>
+#include <ctime>
+
+#include "scalereading.h"
+
+// Large enough for the JSON of a reading with every channel
+#define READING_JSON_SIZE       2048
+
+size_t FormatReadingJson(const ScaleReading& reading, char* buffer, size_t bufferSize);
+void WriteSnapshot(std::ostream& out, const ScaleReading& currentReading, const tm* currentTimeLocal);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cstdint>
 #include <string>
 #include <cstring>
@@ -10,15 +11,43 @@
 #include <stdexcept>
 #include <cerrno>
 #include <thread>
+#include <system_error>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
 #include <vector>
 #include <ctime>
+#include <chrono>
 
 #include <signal.h>
+#include <poll.h>
+#include <sched.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 
-#include <nlohmann/json.hpp>
 #include "utils.h"
-#include "serialdriver.h"
+#include "scaleparser.h"
+#include "readingformat.h"
+#include "readingarchive.h"
+#include "portwatcher.h"
+#ifdef SCALEPARSER_ALLOC_CHECK
+#include "alloccounter.h"
+
+// Boundaries printed with data before the heap must no longer be used
+#define ALLOC_CHECK_WARMUP      2
+#endif
+
+// Frames the collector can be ahead of the parser before dropping them
+#define FRAME_POOL_SIZE         64
+
+// A lost port is also retried this often, in case its return was not seen
+#define PORT_RETRY_MS           1000
+
+// Stack of each parser thread in realtime mode, where all of it is locked
+#define REALTIME_STACK_SIZE     (256 * 1024)
 
 class ScaleDataParser
 {
@@ -30,6 +59,9 @@ class ScaleDataParser
         ~ScaleDataParser();
 
         void                        RunParser();
+        void                        RunParserEventLoop();
+        void                        EnableRealtime(int priority, std::vector<int> cpus);
+        void                        EnableArchive(std::string archivePath);
 
         // Return attribute methods
         int                         Baud(){ return baudRate; };
@@ -37,6 +69,15 @@ class ScaleDataParser
         
         
     private:
+        // A complete frame and the time its closing character was read
+        struct RawFrame
+        {
+            char                                    data[SCALE_MAX_FRAME_SIZE];
+            size_t                                  size;
+            std::chrono::system_clock::time_point   timestamp;
+            std::chrono::steady_clock::time_point   received;
+        };
+
         // --------------- Private Attributes --------------- //
         // Configuration attributes
         int                         baudRate;
@@ -44,22 +85,91 @@ class ScaleDataParser
         std::string                 serialPort;
         
         std::mutex                  rawDataMutex;
-        std::vector<std::string>    serialDataList;
+        std::condition_variable     rawDataCondition;
 
-        // Json data attributes
-        nlohmann::json              parsedData;
-        std::mutex                  jsonDataMutex;
+        // Raw frame pool, a ring allocated at startup and guarded by rawDataMutex
+        std::vector<RawFrame>       framePool;
+        size_t                      poolHead;
+        size_t                      poolCount;
+        uint64_t                    framesOverrun;
+
+        // First error thrown by a thread, guarded by termFlagMutex
+        std::string                 threadError;
+
+        // Realtime attributes
+        bool                        realtime;
+        int                         realtimePriority;
+        std::vector<int>            threadCpus;
+
+        // Parsed data attributes
+        ScaleReadingParser          readingParser;
+        ScaleReading                latestReading;
+        std::mutex                  readingMutex;
         bool                        dataReady;
 
+        // Every reading is appended to the archive by the parsing context
+        std::string                 archivePath;
+        std::unique_ptr<ReadingArchiveWriter> archiveWriter;
+
+        // Statistics, only written by the parsing context
+        std::atomic<uint64_t>       framesParsed;
+        double                      latencySumUs;
+        double                      latencyMaxUs;
+
+        // Reconnect statistics, only written by the collecting context
+        uint64_t                    reconnects;
+        double                      outageSumMs;
+        double                      outageMaxMs;
+        uint64_t                    reopensSeen;
+        double                      reopenSumUs;
+        double                      reopenMaxUs;
+        uint64_t                    frameGaps;
+        double                      gapSumMs;
+        double                      gapMaxMs;
+        bool                        awaitingFrame;
+        std::chrono::steady_clock::time_point   portLostAt;
+        std::chrono::steady_clock::time_point   lastFrameAt;
+
+        // Statistics, only written by the printing context
+        uint64_t                    boundariesPrinted;
+        double                      jitterSumUs;
+        double                      jitterMaxUs;
+
+#ifdef SCALEPARSER_ALLOC_CHECK
+        // Allocation check attributes, only written by the printing context
+        uint64_t                    boundariesWithData;
+        uint64_t                    warmupAllocations;
+#endif
+
         // ----------------- Private Methods ---------------- //
         void                        CollectDataFromSerial();
-        
-        nlohmann::json              ParseDataToJson(std::vector<std::string> serialData);
-        std::vector<std::string>    SplitLines(std::string rawString);
+
+        void                        RecordPortLost(const char* reason);
+        bool                        ReopenPort(std::function<void()> openPort, bool portChanged);
+        void                        RecordFrameArrival(std::chrono::steady_clock::time_point received);
+
         void                        ProcessData();
+        void                        WarnNegativeWeights(const ScaleReading& reading);
+        void                        RecordFrameLatency(std::chrono::steady_clock::time_point received);
 
         void                        PrintData();
-        
+        void                        PrintSnapshot(const ScaleReading& currentData, tm* currentTimeLocal);
+        time_t                      NextPrintBoundary(time_t after);
+        bool                        SleepUntilBoundary(time_t boundary);
+        void                        RecordBoundaryJitter(time_t boundary);
+        void                        PrintStats(const rusage& startUsage);
+        void                        CloseArchive();
+
+#ifdef SCALEPARSER_ALLOC_CHECK
+        void                        CheckAllocations();
+        void                        VerifyAllocations();
+#endif
+
+        void                        RunThread(void (ScaleDataParser::*threadFunction)());
+        void                        LockMemory();
+        void                        PrefaultStack();
+        void                        SetThreadRealtime(pthread_t thread, int cpu);
+
         
 };
 
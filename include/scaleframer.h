@@ -0,0 +1,41 @@
+#ifndef SCALEFRAMER_H
+#define SCALEFRAMER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <functional>
+
+// Frames larger than this are corrupted and are dropped
+#define SCALE_MAX_FRAME_SIZE    4096
+
+class ScaleFramer
+{
+    public:
+        // --------------- Public Attributes ---------------- //
+        typedef std::function<void(const char* frame, size_t size)> FrameCallback;
+
+        // ----------------- Public Methods ----------------- //
+        ScaleFramer(FrameCallback callback);
+
+        void                        Feed(const char* data, size_t size);
+        void                        Reset();
+
+        // Return attribute methods
+        uint64_t                    FramesAssembled(){ return framesAssembled; };
+        uint64_t                    FramesDropped(){ return framesDropped; };
+
+    private:
+        // --------------- Private Attributes --------------- //
+        FrameCallback               frameCallback;
+        std::string                 frameBuffer;
+        bool                        frameStarted;
+
+        uint64_t                    framesAssembled;
+        uint64_t                    framesDropped;
+
+        // ----------------- Private Methods ---------------- //
+        void                        Append(const char* data, size_t size);
+};
+
+#endif
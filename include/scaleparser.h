@@ -0,0 +1,55 @@
+#ifndef SCALEPARSER_H
+#define SCALEPARSER_H
+
+/*
+ * libscaleparser public interface. Bytes from a Pacific Scales serial
+ * stream are either pushed in by the caller or read from an attached
+ * serial port, and every parsed frame is handed to a callback as a
+ * reference to a ScaleReading. The reading is only valid during the call.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "scalereading.h"
+#include "scaleframer.h"
+#include "scalereadingparser.h"
+#include "serialdriver.h"
+
+class ScaleParser
+{
+    public:
+        // --------------- Public Attributes ---------------- //
+        typedef std::function<void(const ScaleReading& reading)> ReadingCallback;
+
+        // ----------------- Public Methods ----------------- //
+        ScaleParser(ReadingCallback callback);
+        ~ScaleParser();
+
+        void                            Push(const char* data, size_t size);
+
+        void                            AttachPort(const char* portPath, uint32_t baudRate);
+        void                            DetachPort();
+        bool                            ReadPort();
+
+        // Return attribute methods
+        int32_t                         Descriptor();
+        uint64_t                        FramesParsed(){ return framesParsed; };
+        uint64_t                        FramesDropped(){ return framer.FramesDropped(); };
+
+    private:
+        // --------------- Private Attributes --------------- //
+        ReadingCallback                 readingCallback;
+        ScaleFramer                     framer;
+        ScaleReadingParser              readingParser;
+        ScaleReading                    reading;
+        std::unique_ptr<SerialDriver>   serialDriver;
+
+        uint64_t                        framesParsed;
+
+        // ----------------- Private Methods ---------------- //
+        void                            OnFrame(const char* frame, size_t size);
+};
+
+#endif
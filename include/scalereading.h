@@ -0,0 +1,43 @@
+#ifndef SCALEREADING_H
+#define SCALEREADING_H
+
+#include <cstdint>
+#include <chrono>
+
+// Fixed sizes so that a reading never needs the heap
+#define SCALE_MAX_CHANNELS      16
+#define SCALE_NAME_SIZE         16
+#define SCALE_UNIT_SIZE         4
+
+/*
+ * A single named weight from a frame, e.g. "A    :   5000 Kg".
+ * Negative weights come from uncalibrated scales and are reported
+ * as 0 in value, the weight as sent is kept in rawValue.
+ */
+struct ScaleChannel
+{
+    char                                    name[SCALE_NAME_SIZE];
+    char                                    unit[SCALE_UNIT_SIZE];
+    int32_t                                 value;
+    int32_t                                 rawValue;
+};
+
+/*
+ * One parsed frame. Channels are kept in the order they were sent,
+ * the TOTAL line is held separately. VALID is only meaningful when
+ * a TOTAL was received and signifies that the channels sum to it.
+ */
+struct ScaleReading
+{
+    ScaleChannel                            channels[SCALE_MAX_CHANNELS];
+    uint8_t                                 channelCount;
+    ScaleChannel                            total;
+    bool                                    hasTotal;
+    bool                                    valid;
+
+    // Wall clock time and monotonic time the frame was completed
+    std::chrono::system_clock::time_point   timestamp;
+    std::chrono::steady_clock::time_point   received;
+};
+
+#endif
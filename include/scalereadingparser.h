@@ -0,0 +1,33 @@
+#ifndef SCALEREADINGPARSER_H
+#define SCALEREADINGPARSER_H
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+
+#include "scalereading.h"
+
+// Lines longer than this are truncated
+#define SCALE_MAX_LINE_SIZE     64
+
+class ScaleReadingParser
+{
+    public:
+        // --------------- Public Attributes ---------------- //
+
+        // ----------------- Public Methods ----------------- //
+        ScaleReadingParser();
+
+        bool                        Parse(const char* frame, size_t size, ScaleReading& reading);
+
+    private:
+        // --------------- Private Attributes --------------- //
+        int64_t                     channelSum;
+
+        // ----------------- Private Methods ---------------- //
+        void                        ParseLine(const char* line, size_t size, ScaleReading& reading);
+};
+
+#endif
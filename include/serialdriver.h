@@ -5,12 +5,14 @@
 #include <cerrno>
 #include <filesystem>
 #include <string>
+#include <stdexcept>
 
 #include <fcntl.h> 
+#include <poll.h>
 #include <termios.h> 
 #include <unistd.h>
 
-#include "utils.h"
+#include "errormsg.h"
 
 class SerialDriver
 {
@@ -20,7 +22,11 @@ class SerialDriver
         // ----------------- Public Methods ----------------- //
         SerialDriver(const char* portPath, uint32_t baudRate);
         ~SerialDriver();
-        std::string serialRead();
+        size_t      serialRead(char* dataBuffer, size_t bufferSize, int timeoutMs);
+        size_t      serialReadAvailable(char* dataBuffer, size_t bufferSize);
+
+        // Return attribute methods
+        int32_t     Descriptor(){ return serialPort; };
        
     private:
         // --------------- Private Attributes --------------- //
@@ -9,10 +9,11 @@
 
 #include <signal.h>
 
+#include "errormsg.h"
+
 extern volatile bool    terminateProgram;
 extern std::mutex       termFlagMutex;
 
-std::string ErrorMsg(int8_t errorNo, std::string msg);
 void signalHandler(int signum);
 
 void setupSignalHandling();
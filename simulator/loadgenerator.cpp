@@ -0,0 +1,511 @@
+#include <loadgenerator.h>
+
+/* 
+ * The constructor instanciate a load generator and opens the pseudo
+ * terminal pair it writes through. Frames have the given number of
+ * channels and are sent at the given rate, 0 for as fast as possible.
+ * With a baud rate, the data rate is also limited to that line rate.
+ */
+LoadGenerator::LoadGenerator(int channels, double frameRate, uint32_t baud, LoadFaults faults)
+    : frameGenerator(channels, std::random_device()()), random(std::random_device()())
+{
+    // Make sure the number of channels can be named and parsed
+    if (channels <= 0 || channels > SCALE_MAX_CHANNELS)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Channels must be between 1 and " + std::to_string(SCALE_MAX_CHANNELS) + ". Input: " + std::to_string(channels));
+        throw std::runtime_error(errMsg);
+    }
+
+    if (frameRate < 0)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Frame rate must not be negative. Input: " + std::to_string(frameRate));
+        throw std::runtime_error(errMsg);
+    }
+
+    // Initialise private attributes
+    channelCount = channels;
+    framesPerSecond = frameRate;
+    baudRate = baud;
+    faultRates = faults;
+    hogThreads = 0;
+    replugPeriod = 0;
+    runDuration = 0;
+    nextRow = 0;
+
+    framesSent = 0;
+    framesIntact = 0;
+    bytesSent = 0;
+    replugs = 0;
+    framesReceived = 0;
+    framesInvalid = 0;
+    parserReady = false;
+    stopCheck = false;
+    stopHog = false;
+
+    OpenPseudoTerminal();
+}
+
+/* 
+ * Destructor for LoadGenerator closes the pseudo terminal pair
+ * and removes the link to it, if any.
+ */
+LoadGenerator::~LoadGenerator()
+{
+    if (!linkPath.empty()) unlink(linkPath.c_str());
+    close(slavePort);
+    close(masterPort);
+}
+
+/*
+ * Open a pseudo terminal pair. The slave side is what the parser opens
+ * as its serial port. It is also kept open here, in raw mode, so writes
+ * are not echoed or altered while no parser is attached. The master side
+ * does not block, so a parser that stops reading cannot hold up the run.
+ */
+void LoadGenerator::OpenPseudoTerminal()
+{
+    masterPort = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (masterPort < 0 || grantpt(masterPort) != 0 || unlockpt(masterPort) != 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to create a pseudo terminal.");
+        throw std::runtime_error(errMsg);
+    }
+
+    char slaveName[128];
+    if (ptsname_r(masterPort, slaveName, sizeof(slaveName)) != 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to get the pseudo terminal name.");
+        throw std::runtime_error(errMsg);
+    }
+    slavePath = slaveName;
+
+    slavePort = open(slaveName, O_RDWR | O_NOCTTY);
+    if (slavePort < 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to open the pseudo terminal: " + slavePath);
+        throw std::runtime_error(errMsg);
+    }
+
+    termios slaveCfg;
+    tcgetattr(slavePort, &slaveCfg);
+    cfmakeraw(&slaveCfg);
+    tcsetattr(slavePort, TCSANOW, &slaveCfg);
+}
+
+/*
+ * Load the channel weights from a CSV file such as mass_test.csv.
+ * The first line is the header, each following line is a frame with
+ * one weight per column. The first columns are used as the channels.
+ */
+void LoadGenerator::LoadMassFile(std::string path)
+{
+    std::ifstream massFile(path);
+    if (!massFile)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to open the mass file: " + path);
+        throw std::runtime_error(errMsg);
+    }
+
+    std::string line;
+    // Skip the header
+    std::getline(massFile, line);
+
+    while (std::getline(massFile, line))
+    {
+        std::vector<int> row;
+        std::stringstream lineStream(line);
+        std::string cell;
+
+        while ((int)row.size() < channelCount && std::getline(lineStream, cell, ','))
+            row.push_back(atoi(cell.c_str()));
+
+        // Skip empty lines
+        if (row.empty()) continue;
+
+        if ((int)row.size() < channelCount)
+        {
+            std::string errMsg = ErrorMsg(EINVAL, "Mass file has fewer than " + std::to_string(channelCount) + " columns: " + path);
+            throw std::runtime_error(errMsg);
+        }
+
+        massRows.push_back(row);
+    }
+}
+
+/*
+ * Link the slave side of the pseudo terminal to a fixed path,
+ * replacing whatever is there.
+ */
+void LoadGenerator::LinkSlave(std::string path)
+{
+    unlink(path.c_str());
+
+    if (symlink(slavePath.c_str(), path.c_str()) != 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to link the pseudo terminal to: " + path);
+        throw std::runtime_error(errMsg);
+    }
+
+    linkPath = path;
+}
+
+/*
+ * Run the given number of threads which only burn CPU while frames
+ * are generated, to see how the parser holds up on a loaded machine.
+ */
+void LoadGenerator::SetCpuHog(int threads)
+{
+    if (threads < 0)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "CPU hog threads must not be negative. Input: " + std::to_string(threads));
+        throw std::runtime_error(errMsg);
+    }
+
+    hogThreads = threads;
+}
+
+/*
+ * Unplug the pseudo terminal every period seconds and plug a new one in
+ * at the same link, as a USB serial adapter coming loose would, so the
+ * parser's reconnect can be tested. Needs the slave linked to a path.
+ */
+void LoadGenerator::SetReplug(double period)
+{
+    if (period < 0)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Replug period must not be negative. Input: " + std::to_string(period));
+        throw std::runtime_error(errMsg);
+    }
+
+    if (period > 0 && linkPath.empty())
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Replugging needs the pseudo terminal linked to a path.");
+        throw std::runtime_error(errMsg);
+    }
+
+    replugPeriod = period;
+}
+
+/*
+ * Remove the link and close the pseudo terminal, so the parser sees it
+ * hang up, then after a while open a new one and link it again.
+ */
+void LoadGenerator::Replug()
+{
+    unlink(linkPath.c_str());
+    close(slavePort);
+    close(masterPort);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(LOADGEN_UNPLUGGED_MS));
+
+    OpenPseudoTerminal();
+    LinkSlave(linkPath);
+    replugs++;
+}
+
+/*
+ * Generate frames for the given duration, or until terminated. With
+ * selfCheck, a parser from libscaleparser is attached to the slave side
+ * on a separate thread and counts the frames it receives. Otherwise
+ * an external parser is given startDelay seconds to attach first.
+ */
+void LoadGenerator::Run(double duration, double startDelay, bool selfCheck)
+{
+    double parserCpuSeconds = 0;
+    std::thread parserCheck;
+
+    if (selfCheck)
+    {
+        parserCheck = std::thread(&LoadGenerator::CheckParser, this, std::ref(parserCpuSeconds));
+        while (!parserReady) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    else
+        std::this_thread::sleep_for(std::chrono::duration<double>(startDelay));
+
+    std::vector<std::thread> cpuHogs;
+    for (int indx = 0; indx < hogThreads; indx++)
+        cpuHogs.emplace_back(&LoadGenerator::HogCpu, this);
+
+    rusage startUsage;
+    getrusage(RUSAGE_THREAD, &startUsage);
+    runStart = std::chrono::steady_clock::now();
+    runDuration = duration;
+    std::chrono::duration<double> elapsed(0);
+    std::string pending;
+    bool terminateCalled = false;
+    double nextReplug = replugPeriod;
+
+    // Loop until the duration is over or it is terminated
+    while (elapsed.count() < duration && !terminateCalled)
+    {
+        termFlagMutex.lock();
+        terminateCalled = terminateProgram;
+        termFlagMutex.unlock();
+
+        // Replug the pseudo terminal when due. Time unplugged is not counted,
+        // so frames are not sent in a burst to catch up afterwards
+        if (replugPeriod > 0 && elapsed.count() >= nextReplug)
+        {
+            if (!pending.empty()) WriteFrames(pending);
+            pending.clear();
+
+            std::chrono::steady_clock::time_point unpluggedAt = std::chrono::steady_clock::now();
+            Replug();
+            runStart += std::chrono::steady_clock::now() - unpluggedAt;
+            nextReplug += replugPeriod;
+        }
+
+        // Hold back this write until both the frame rate and line rate allow it
+        double dueSeconds = 0;
+        if (framesPerSecond > 0) dueSeconds = framesSent / framesPerSecond;
+        if (baudRate > 0) dueSeconds = std::max(dueSeconds, bytesSent / (baudRate / 10.0));
+
+        std::chrono::steady_clock::time_point due = runStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(dueSeconds));
+        // Only sleep when well ahead, otherwise catch up
+        if (due - std::chrono::steady_clock::now() > std::chrono::microseconds(200))
+            std::this_thread::sleep_until(due);
+
+        pending += NextFrame();
+
+        // Glued frames are held back and written together with the next one
+        if (!Roll(faultRates.glue))
+        {
+            WriteFrames(pending);
+            pending.clear();
+        }
+
+        elapsed = std::chrono::steady_clock::now() - runStart;
+    }
+
+    if (!pending.empty()) WriteFrames(pending);
+    elapsed = std::chrono::steady_clock::now() - runStart;
+
+    rusage endUsage;
+    getrusage(RUSAGE_THREAD, &endUsage);
+    double cpuSeconds = (endUsage.ru_utime.tv_sec - startUsage.ru_utime.tv_sec) + (endUsage.ru_stime.tv_sec - startUsage.ru_stime.tv_sec)
+                      + ((endUsage.ru_utime.tv_usec - startUsage.ru_utime.tv_usec) + (endUsage.ru_stime.tv_usec - startUsage.ru_stime.tv_usec)) / 1e6;
+
+    stopHog = true;
+    for (std::thread& cpuHog : cpuHogs) cpuHog.join();
+
+    if (selfCheck)
+    {
+        // Let the parser drain, until it has every frame or stops making progress
+        uint64_t lastReceived = -1;
+        while (framesReceived - framesInvalid < framesIntact && framesReceived != lastReceived)
+        {
+            lastReceived = framesReceived;
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+
+        stopCheck = true;
+        parserCheck.join();
+    }
+    // Give an external parser time to read the last frames before closing
+    else
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    PrintReport(elapsed.count(), cpuSeconds, parserCpuSeconds, selfCheck);
+}
+
+/*
+ * Get the next frame, from the mass file if one was loaded, otherwise
+ * with random weights, and apply the garbage and dropped delimiter faults.
+ */
+std::string LoadGenerator::NextFrame()
+{
+    std::string frame = massRows.empty() ? frameGenerator.Frame(false) : frameGenerator.Frame(massRows[nextRow++ % massRows.size()]);
+    framesSent++;
+
+    // Drop either the start or the closing character, the frame is lost
+    if (Roll(faultRates.drop))
+    {
+        if (random() % 2) frame.erase(0, 1);
+        else frame.erase(frame.rfind('\\'), 1);
+    }
+    else
+        framesIntact++;
+
+    // Garbage in front of the frame is purged by the parser
+    if (Roll(faultRates.garbage))
+    {
+        std::uniform_int_distribution<int> garbageSize(1, 32);
+        std::uniform_int_distribution<int> garbageChar(0x20, 0x7e);
+        std::string garbage;
+
+        for (int indx = garbageSize(random); indx > 0; indx--)
+        {
+            char character = garbageChar(random);
+            garbage += (character == '/' || character == '\\') ? '#' : character;
+        }
+
+        frame.insert(0, garbage);
+    }
+
+    return frame;
+}
+
+/*
+ * Write frames to the pseudo terminal. Split frames are written in
+ * several parts, so the parser may read them part way through.
+ */
+void LoadGenerator::WriteFrames(const std::string& data)
+{
+    if (!Roll(faultRates.split))
+    {
+        WriteAll(data.data(), data.size());
+        return;
+    }
+
+    std::uniform_int_distribution<size_t> splitPos(1, data.size() - 1);
+    size_t firstSplit = splitPos(random);
+    size_t secondSplit = splitPos(random);
+    if (firstSplit > secondSplit) std::swap(firstSplit, secondSplit);
+
+    WriteAll(data.data(), firstSplit);
+    std::this_thread::yield();
+    WriteAll(data.data() + firstSplit, secondSplit - firstSplit);
+    std::this_thread::yield();
+    WriteAll(data.data() + secondSplit, data.size() - secondSplit);
+}
+
+/*
+ * Write all of the data to the master side. This waits while the parser
+ * is not keeping up, so the achieved rate drops instead. Once the run is
+ * over or it is terminated, whatever is left is not written.
+ */
+void LoadGenerator::WriteAll(const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(masterPort, data, size);
+
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            termFlagMutex.lock();
+            bool terminateCalled = terminateProgram;
+            termFlagMutex.unlock();
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - runStart;
+            double remaining = runDuration - elapsed.count();
+            if (terminateCalled || remaining <= 0) return;
+
+            // Wait for room, waking regularly to check for termination
+            pollfd masterPoll = {masterPort, POLLOUT, 0};
+            if (poll(&masterPoll, 1, int(std::min(remaining * 1000, 100.0)) + 1) < 0 && errno != EINTR)
+            {
+                std::string errMsg = ErrorMsg(errno, "Waiting on the pseudo terminal failed!");
+                throw std::runtime_error(errMsg);
+            }
+            continue;
+        }
+        if (written < 0)
+        {
+            std::string errMsg = ErrorMsg(errno, "Writing to the pseudo terminal failed!");
+            throw std::runtime_error(errMsg);
+        }
+
+        data += written;
+        size -= written;
+        bytesSent += written;
+    }
+}
+
+/*
+ * Return true for the given percentage of calls.
+ */
+bool LoadGenerator::Roll(int percent)
+{
+    return percent > 0 && int(random() % 100) < percent;
+}
+
+/*
+ * Attach a parser to the slave side and count the frames it receives,
+ * and how many of them were not VALID. Runs until stopped, then reports
+ * the CPU time it used.
+ * Note: Should be run on a separate thread.
+ */
+void LoadGenerator::CheckParser(double& cpuSeconds)
+{
+    ScaleParser scaleParser([this](const ScaleReading& reading){
+        framesReceived++;
+        if (!reading.valid) framesInvalid++;
+    });
+
+    rusage startUsage;
+    getrusage(RUSAGE_THREAD, &startUsage);
+
+    // Errors are reported here, they cannot be thrown out of the thread
+    try
+    {
+        scaleParser.AttachPort(slavePath.c_str(), baudRate ? baudRate : 115200);
+        pollfd serialPoll = {scaleParser.Descriptor(), POLLIN, 0};
+        parserReady = true;
+
+        while (!stopCheck)
+        {
+            int ready = poll(&serialPoll, 1, 50);
+
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready < 0)
+            {
+                std::string errMsg = ErrorMsg(errno, "Waiting on the pseudo terminal failed!");
+                throw std::runtime_error(errMsg);
+            }
+
+            if (ready > 0) scaleParser.ReadPort();
+        }
+    }
+
+    catch(std::runtime_error e)
+    {
+        std::cout << e.what() << std::endl;
+        parserReady = true;
+    }
+
+    rusage endUsage;
+    getrusage(RUSAGE_THREAD, &endUsage);
+    cpuSeconds = (endUsage.ru_utime.tv_sec - startUsage.ru_utime.tv_sec) + (endUsage.ru_stime.tv_sec - startUsage.ru_stime.tv_sec)
+               + ((endUsage.ru_utime.tv_usec - startUsage.ru_utime.tv_usec) + (endUsage.ru_stime.tv_usec - startUsage.ru_stime.tv_usec)) / 1e6;
+}
+
+/*
+ * Spin until stopped.
+ * Note: Should be run on a separate thread.
+ */
+void LoadGenerator::HogCpu()
+{
+    volatile uint64_t spins = 0;
+    while (!stopHog) spins++;
+}
+
+/*
+ * Print the achieved rate and, with the self check, the frames the
+ * parser lost out of those sent intact.
+ */
+void LoadGenerator::PrintReport(double elapsed, double cpuSeconds, double parserCpuSeconds, bool selfCheck)
+{
+    std::cout << "Frames sent: " << framesSent << " | Intact: " << framesIntact << " | Bytes: " << bytesSent << std::endl;
+    std::cout << "Achieved rate: " << framesSent / elapsed << " frames/s | " << bytesSent / elapsed / 1000 << " kB/s";
+    std::cout << " over " << elapsed << " s" << std::endl;
+    std::cout << "Generator CPU: " << cpuSeconds << " s (" << 100 * cpuSeconds / elapsed << "%)" << std::endl;
+    if (replugPeriod > 0)
+        std::cout << "Replugs: " << replugs << " | " << LOADGEN_UNPLUGGED_MS << " ms unplugged each, not counted in the time above" << std::endl;
+
+    if (!selfCheck)
+    {
+        std::cout << "Compare the intact frames with the frames parsed reported by the parser on exit." << std::endl;
+        return;
+    }
+
+    // Intact frames always sum up, so only VALID ones are counted as received.
+    // Invalid ones are corrupted frames that were merged together.
+    int64_t framesLost = int64_t(framesIntact) - int64_t(framesReceived - framesInvalid);
+    std::cout << "Parser received: " << framesReceived << " | Lost: " << framesLost;
+    std::cout << " (" << (framesIntact ? 100.0 * framesLost / framesIntact : 0) << "%)";
+    std::cout << " | Invalid: " << framesInvalid << std::endl;
+    std::cout << "Parser CPU: " << parserCpuSeconds << " s (" << 100 * parserCpuSeconds / elapsed << "%)";
+    std::cout << " | " << (framesReceived ? 1e9 * parserCpuSeconds / framesReceived : 0) << " ns/frame" << std::endl;
+}
@@ -0,0 +1,104 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/resource.h>
+
+#include <utils.h>
+#include <scaleparser.h>
+#include <framegenerator.h>
+
+// How long the pseudo terminal is gone for when it is replugged
+#define LOADGEN_UNPLUGGED_MS    500
+
+// Fault patterns, as a percentage of frames they are applied to
+struct LoadFaults
+{
+    int                         split;
+    int                         glue;
+    int                         garbage;
+    int                         drop;
+};
+
+class LoadGenerator
+{
+    public:
+        // --------------- Public Attributes ---------------- //
+
+        // ----------------- Public Methods ----------------- //
+        LoadGenerator(int channels, double frameRate, uint32_t baud, LoadFaults faults);
+        ~LoadGenerator();
+
+        void                        LoadMassFile(std::string path);
+        void                        LinkSlave(std::string path);
+        void                        SetCpuHog(int threads);
+        void                        SetReplug(double period);
+        void                        Run(double duration, double startDelay, bool selfCheck);
+
+        // Return attribute methods
+        std::string                 SlavePath(){ return slavePath; };
+
+    private:
+        // --------------- Private Attributes --------------- //
+        // Configuration attributes
+        int                         channelCount;
+        double                      framesPerSecond;
+        uint32_t                    baudRate;
+        LoadFaults                  faultRates;
+        int                         hogThreads;
+        double                      replugPeriod;
+
+        // Start and duration of the run, writes give up once it is over
+        std::chrono::steady_clock::time_point runStart;
+        double                      runDuration;
+
+        // Pseudo terminal pair
+        int32_t                     masterPort;
+        int32_t                     slavePort;
+        std::string                 slavePath;
+        std::string                 linkPath;
+
+        // Frame sources
+        FrameGenerator              frameGenerator;
+        std::vector<std::vector<int>> massRows;
+        size_t                      nextRow;
+        std::mt19937                random;
+
+        // Counters
+        uint64_t                    framesSent;
+        uint64_t                    framesIntact;
+        uint64_t                    bytesSent;
+        uint64_t                    replugs;
+        std::atomic<uint64_t>       framesReceived;
+        std::atomic<uint64_t>       framesInvalid;
+        std::atomic<bool>           parserReady;
+        std::atomic<bool>           stopCheck;
+        std::atomic<bool>           stopHog;
+
+        // ----------------- Private Methods ---------------- //
+        void                        OpenPseudoTerminal();
+        void                        Replug();
+        std::string                 NextFrame();
+        void                        WriteFrames(const std::string& data);
+        void                        WriteAll(const char* data, size_t size);
+        bool                        Roll(int percent);
+        void                        CheckParser(double& cpuSeconds);
+        void                        HogCpu();
+        void                        PrintReport(double elapsed, double cpuSeconds, double parserCpuSeconds, bool selfCheck);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include <loadgenerator.h>
+
+void PrintHelp()
+{
+    std::cout << "Load generator for the scale data parser, writes frames through a pseudo terminal" << std::endl;
+    std::cout << "Usage: scaleloadgen [-h|--help]" << std::endl;
+    std::cout << "                    [-c|--channels <number> [default: 4]] [-f|--file <mass csv>]" << std::endl;
+    std::cout << "                    [-r|--rate <frames/s> [default: 0, as fast as possible]]" << std::endl;
+    std::cout << "                    [-b|--baud <number> [default: 0, no line rate limit]]" << std::endl;
+    std::cout << "                    [-d|--duration <time(s)> [default: 10]] [-w|--wait <time(s)> [default: 0]]" << std::endl;
+    std::cout << "                    [-l|--link <path>] [-s|--self-check] [-H|--hog <threads>]" << std::endl;
+    std::cout << "                    [--replug <period(s)>]" << std::endl;
+    std::cout << "                    [--split <%>] [--glue <%>] [--garbage <%>] [--drop <%>]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int channels = 4;
+    double frameRate = 0;
+    int baudRate = 0;
+    double duration = 10;
+    double startDelay = 0;
+    bool selfCheck = false;
+    int hogThreads = 0;
+    double replugPeriod = 0;
+    std::string massFile = "";
+    std::string linkPath = "";
+    LoadFaults faults = {0, 0, 0, 0};
+
+    // Loop through all the command line arguments
+    for (int indx = 1; indx < argc; indx++)
+    {
+        std::string currentArg = std::string(argv[indx]);
+
+        if (currentArg == "-h" || currentArg == "--help")
+        {
+            PrintHelp();
+            return 0;
+        }
+        else if (currentArg == "-s" || currentArg == "--self-check")
+        {
+            selfCheck = true;
+            continue;
+        }
+
+        // Every other flag takes a value, made sure that it was actually provided.
+        if (indx + 1 > argc-1)
+        {
+            std::cout << "Error: You did not provide a value for " << currentArg << std::endl;
+            PrintHelp();
+            return -1;
+        }
+        std::string value = std::string(argv[++indx]);
+
+        if (currentArg == "-c" || currentArg == "--channels")
+            channels = atoi(value.c_str());
+        else if (currentArg == "-f" || currentArg == "--file")
+            massFile = value;
+        else if (currentArg == "-r" || currentArg == "--rate")
+            frameRate = atof(value.c_str());
+        else if (currentArg == "-b" || currentArg == "--baud")
+            baudRate = atoi(value.c_str());
+        else if (currentArg == "-d" || currentArg == "--duration")
+            duration = atof(value.c_str());
+        else if (currentArg == "-w" || currentArg == "--wait")
+            startDelay = atof(value.c_str());
+        else if (currentArg == "-l" || currentArg == "--link")
+            linkPath = value;
+        else if (currentArg == "-H" || currentArg == "--hog")
+            hogThreads = atoi(value.c_str());
+        else if (currentArg == "--replug")
+            replugPeriod = atof(value.c_str());
+        else if (currentArg == "--split")
+            faults.split = atoi(value.c_str());
+        else if (currentArg == "--glue")
+            faults.glue = atoi(value.c_str());
+        else if (currentArg == "--garbage")
+            faults.garbage = atoi(value.c_str());
+        else if (currentArg == "--drop")
+            faults.drop = atoi(value.c_str());
+        else
+        {
+            std::cout << "Error: Unknown argument: " << currentArg << std::endl;
+            PrintHelp();
+            return -1;
+        }
+    }
+
+    // The self check parser does not reconnect, it would stop at the first replug
+    if (selfCheck && replugPeriod > 0)
+    {
+        std::cout << "Error: --replug cannot be used with the self check, drive scaleparser through --link instead." << std::endl;
+        PrintHelp();
+        return -1;
+    }
+
+    try
+    {
+        setupSignalHandling();
+        LoadGenerator generator(channels, frameRate, baudRate, faults);
+
+        if (!massFile.empty()) generator.LoadMassFile(massFile);
+        if (!linkPath.empty()) generator.LinkSlave(linkPath);
+        generator.SetCpuHog(hogThreads);
+        generator.SetReplug(replugPeriod);
+
+        std::cout << "Pseudo terminal: " << generator.SlavePath();
+        if (!linkPath.empty()) std::cout << " | Linked at: " << linkPath;
+        std::cout << std::endl;
+
+        generator.Run(duration, startDelay, selfCheck);
+        return 0;
+    }
+
+    catch(std::runtime_error e)
+    {
+        std::cout << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,74 @@
+#include <alloccounter.h>
+#include <atomic>
+
+static std::atomic<uint64_t> allocationCount(0);
+
+/*
+ * Replacements for the global operator new and delete which count
+ * every allocation, including the array, nothrow and aligned forms.
+ */
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* memory = malloc(size ? size : 1);
+    if (memory == NULL) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* memory = NULL;
+    if (posix_memalign(&memory, std::max(size_t(alignment), sizeof(void*)), size ? size : 1) != 0) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { free(memory); }
+
+/*
+ * Return the number of allocations made so far.
+ */
+uint64_t AllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+/*
+ * Return the resident set size of the process in kB, or -1 if it
+ * cannot be read. Reads /proc without allocating.
+ */
+long ResidentSetKb()
+{
+    char statm[128];
+    int statmFile = open("/proc/self/statm", O_RDONLY);
+    if (statmFile < 0) return -1;
+
+    ssize_t size = read(statmFile, statm, sizeof(statm) - 1);
+    close(statmFile);
+    if (size <= 0) return -1;
+    statm[size] = 0;
+
+    // The second field is the resident pages
+    char* residentField = statm;
+    strtol(statm, &residentField, 10);
+    long residentPages = strtol(residentField, NULL, 10);
+
+    return residentPages * (sysconf(_SC_PAGESIZE) / 1024);
+}
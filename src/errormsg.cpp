@@ -0,0 +1,10 @@
+#include <errormsg.h>
+
+/*
+ * Function to construct error messages.
+ */
+
+std::string ErrorMsg(int8_t errorNo, std::string msg)
+{
+    return "Error " + std::to_string(errorNo) + ": " + std::strerror(errorNo) + " | [" + msg +"]";
+}
@@ -6,6 +6,10 @@ void PrintHelp()
     std::cout << "Usage: scaleparser [-h|--help]" << std::endl;
     std::cout << "                   [-p|--port <path>] [-b|--baud <number>]" << std::endl;
     std::cout << "                   [-i|--interval <time(s) [default: 10]>]" << std::endl;
+    std::cout << "                   [-e|--event-loop]" << std::endl;
+    std::cout << "                   [-r|--realtime] [--priority <1-99> [default: 50]]" << std::endl;
+    std::cout << "                   [--cpus <collector>,<parser>,<output>]" << std::endl;
+    std::cout << "                   [-a|--archive <path>]" << std::endl;
 }
 
 
@@ -14,6 +18,11 @@ int main(int argc, char *argv[])
     std::string portPath = "";
     int baudRate = 0;
     int printInterval = 10;
+    bool eventLoop = false;
+    bool realtime = false;
+    int realtimePriority = 50;
+    std::vector<int> threadCpus;
+    std::string archivePath = "";
     
     
     // If no argument was given, print help
@@ -75,6 +84,61 @@ int main(int argc, char *argv[])
                 return -1;
             }
         }
+
+        // Check for single threaded event loop flag
+        else if (currentArg == "-e" || currentArg == "--event-loop")
+            eventLoop = true;
+
+        // Check for realtime flag
+        else if (currentArg == "-r" || currentArg == "--realtime")
+            realtime = true;
+
+        // Check for realtime priority flag
+        else if (currentArg == "--priority")
+        {
+            // Made sure that a priority was actually provided.
+            if (indx + 1 <= argc-1)
+                realtimePriority = atoi(argv[indx+1]);
+            else
+            {
+                std::cout << "Error: You did not provide a priority." << std::endl;
+                PrintHelp();
+                return -1;
+            }
+        }
+
+        // Check for thread CPUs flag
+        else if (currentArg == "--cpus")
+        {
+            // Made sure that the CPUs were actually provided.
+            if (indx + 1 <= argc-1)
+            {
+                std::stringstream cpuList(argv[indx+1]);
+                std::string cpu;
+                while (std::getline(cpuList, cpu, ','))
+                    threadCpus.push_back(atoi(cpu.c_str()));
+            }
+            else
+            {
+                std::cout << "Error: You did not provide the CPUs." << std::endl;
+                PrintHelp();
+                return -1;
+            }
+        }
+
+        // Check for archive flag
+        else if (currentArg == "-a" || currentArg == "--archive")
+        {
+            // Made sure that a path was actually provided.
+            if (indx + 1 <= argc-1)
+                archivePath = std::string(argv[indx+1]);
+            else
+            {
+                std::cout << "Error: You did not provide a path to the archive." << std::endl;
+                PrintHelp();
+                return -1;
+            }
+        }
     }
 
     // Make sure that enough arguments are provided
@@ -95,10 +159,15 @@ int main(int argc, char *argv[])
     {
         setupSignalHandling();
         ScaleDataParser parser(portPath, baudRate, printInterval);
+        if (realtime) parser.EnableRealtime(realtimePriority, threadCpus);
+        if (!archivePath.empty()) parser.EnableArchive(archivePath);
         std::cout << "Initalised parser! Serial port: " << parser.Port();
         std::cout << " | Baud rate: " << parser.Baud() << std::endl;
         
-        parser.RunParser();
+        if (eventLoop)
+            parser.RunParserEventLoop();
+        else
+            parser.RunParser();
         return 0;
     }
     
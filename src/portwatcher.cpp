@@ -0,0 +1,91 @@
+#include <portwatcher.h>
+
+/*
+ * The constructor instanciate a watcher for the given port path. The
+ * directory holding it is watched for the port being created, moved in
+ * or having its permissions changed, as udev does once it is plugged in.
+ */
+PortWatcher::PortWatcher(const char* portPath)
+{
+    std::string path(portPath);
+    size_t seperatorPos = path.rfind('/');
+
+    portDirectory = seperatorPos == std::string::npos ? "." : path.substr(0, std::max(seperatorPos, size_t(1)));
+    portName = seperatorPos == std::string::npos ? path : path.substr(seperatorPos + 1);
+
+    watchFile = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFile < 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to create a watch for the serial port: " + path);
+        throw std::runtime_error(errMsg);
+    }
+
+    directoryWatch = -1;
+    WatchDirectory();
+}
+
+PortWatcher::~PortWatcher()
+{
+    close(watchFile);
+}
+
+/*
+ * Start watching the port's directory. It may not exist while nothing is
+ * plugged in, e.g. /dev/serial/by-id, in which case it is tried again on
+ * the next check. Returns true if the watch was added.
+ */
+bool PortWatcher::WatchDirectory()
+{
+    directoryWatch = inotify_add_watch(watchFile, portDirectory.c_str(), IN_CREATE | IN_MOVED_TO | IN_ATTRIB);
+    return directoryWatch >= 0;
+}
+
+/*
+ * Wait up to the given time for the port to change. Returns true if it
+ * did, and it is worth trying to open it.
+ */
+bool PortWatcher::WaitForPort(int timeoutMs)
+{
+    pollfd watchPoll = {watchFile, POLLIN, 0};
+    int ready = poll(&watchPoll, 1, timeoutMs);
+
+    if (ready < 0 && errno != EINTR)
+    {
+        std::string errMsg = ErrorMsg(errno, "Waiting for the serial port failed!");
+        throw std::runtime_error(errMsg);
+    }
+
+    return PortChanged();
+}
+
+/*
+ * Read every pending event without waiting. Returns true if any of them
+ * was for the port, or if the directory could only now be watched and
+ * the port may have appeared unseen.
+ */
+bool PortWatcher::PortChanged()
+{
+    if (directoryWatch < 0) return WatchDirectory();
+
+    bool changed = false;
+    alignas(inotify_event) char eventBuffer[4096];
+
+    while (true)
+    {
+        ssize_t receiveSize = read(watchFile, eventBuffer, sizeof(eventBuffer));
+        if (receiveSize < 0 && errno == EINTR) continue;
+        if (receiveSize <= 0) break;
+
+        for (char* pos = eventBuffer; pos < eventBuffer + receiveSize; )
+        {
+            inotify_event* event = (inotify_event*)pos;
+            pos += sizeof(inotify_event) + event->len;
+
+            // The directory itself was removed, watch it again once it is back
+            if (event->mask & IN_IGNORED) directoryWatch = -1;
+            else if (event->len && portName == event->name) changed = true;
+        }
+    }
+
+    return changed;
+}
@@ -0,0 +1,660 @@
+#include <readingarchive.h>
+
+// Largest header: the fixed fields, every column and every column size
+#define ARCHIVE_HEADER_SIZE     (26 + ARCHIVE_MAX_COLUMNS * (2 + SCALE_NAME_SIZE + SCALE_UNIT_SIZE + 8) + (ARCHIVE_MAX_COLUMNS + 2) * 4)
+// Bytes a zigzag varint of a 64 bit value can take
+#define ARCHIVE_VARINT_SIZE     10
+// Bytes a reading can add to a weight column: a run of none and a 33 bit delta
+#define ARCHIVE_WEIGHT_SIZE     6
+
+static const char archiveMagic[4] = {'S', 'C', 'A', 'R'};
+static const char blockMagic[4] = {'S', 'C', 'B', 'K'};
+
+/*
+ * Map signed values to unsigned so small negative deltas stay small:
+ * 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+ */
+static inline uint64_t ZigZag(int64_t value)
+{
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static inline int64_t UnZigZag(uint64_t value)
+{
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+/*
+ * Append a varint, 7 bits per byte with the high bit set on all but the
+ * last byte. The column has room for it, so nothing is allocated.
+ */
+static void PutVarint(std::vector<uint8_t>& column, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        column.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    column.push_back(uint8_t(value));
+}
+
+/*
+ * Little endian integers in and out of a header buffer.
+ */
+static uint8_t* PutInt(uint8_t* pos, uint64_t value, size_t size)
+{
+    for (size_t indx = 0; indx < size; indx++) pos[indx] = uint8_t(value >> (8 * indx));
+    return pos + size;
+}
+
+static uint64_t GetInt(const uint8_t* pos, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t indx = 0; indx < size; indx++) value |= uint64_t(pos[indx]) << (8 * indx);
+    return value;
+}
+
+/*
+ * Read until the size is reached or the file ends.
+ * Returns the number of bytes read.
+ */
+static size_t ReadFully(int32_t archiveFile, void* buffer, size_t size)
+{
+    size_t received = 0;
+
+    while (received < size)
+    {
+        ssize_t receiveSize = read(archiveFile, (uint8_t*)buffer + received, size - received);
+        if (receiveSize < 0 && errno == EINTR) continue;
+        if (receiveSize < 0)
+        {
+            std::string errMsg = ErrorMsg(errno, "Failed to read the archive.");
+            throw std::runtime_error(errMsg);
+        }
+        if (receiveSize == 0) break;
+        received += receiveSize;
+    }
+
+    return received;
+}
+
+static void ThrowCorrupted(std::string what)
+{
+    std::string errMsg = ErrorMsg(EINVAL, "Archive is corrupted: " + what);
+    throw std::runtime_error(errMsg);
+}
+
+/*
+ * Decode a column of varints into values, at most maxCount of them.
+ * Runs of single byte varints, which most of a column is, are found eight
+ * at a time by checking a whole word for high bits, and widened in a loop
+ * the compiler vectorises. Anything else takes the byte by byte path.
+ * Returns the number of values decoded.
+ */
+static size_t DecodeVarints(const uint8_t* data, size_t size, uint64_t* values, size_t maxCount)
+{
+    size_t pos = 0;
+    size_t decoded = 0;
+
+    while (pos < size)
+    {
+        if (decoded == maxCount) ThrowCorrupted("column holds more values than readings");
+
+        if (decoded + 8 <= maxCount && pos + 8 <= size)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + pos, sizeof(word));
+            if ((word & 0x8080808080808080ULL) == 0)
+            {
+                for (size_t indx = 0; indx < 8; indx++) values[decoded + indx] = data[pos + indx];
+                decoded += 8;
+                pos += 8;
+                continue;
+            }
+        }
+
+        uint64_t value = 0;
+        for (int shift = 0; ; shift += 7)
+        {
+            if (pos >= size || shift > 63) ThrowCorrupted("varint runs past its column");
+            uint8_t byte = data[pos++];
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        values[decoded++] = value;
+    }
+
+    return decoded;
+}
+
+/*
+ * Read the header of the next block. Returns false if there is no whole
+ * block left, i.e. at the end of the archive or at a block cut short
+ * by the writer stopping midway. Throws if the header is not valid.
+ */
+bool ReadBlockHeader(int32_t archiveFile, ArchiveBlockHeader& header)
+{
+    uint8_t prefix[8];
+    if (ReadFully(archiveFile, prefix, sizeof(prefix)) < sizeof(prefix)) return false;
+    if (std::memcmp(prefix, blockMagic, sizeof(blockMagic)) != 0) ThrowCorrupted("bad block magic");
+
+    uint32_t headerSize = GetInt(prefix + 4, 4);
+    if (headerSize > ARCHIVE_HEADER_SIZE) ThrowCorrupted("block header too large");
+
+    uint8_t headerBuffer[ARCHIVE_HEADER_SIZE];
+    if (ReadFully(archiveFile, headerBuffer, headerSize) < headerSize) return false;
+
+    const uint8_t* pos = headerBuffer;
+    const uint8_t* end = headerBuffer + headerSize;
+    if (end - pos < 26) ThrowCorrupted("block header too small");
+
+    header.readingCount = GetInt(pos, 4);       pos += 4;
+    header.minTimeMs = GetInt(pos, 8);          pos += 8;
+    header.maxTimeMs = GetInt(pos, 8);          pos += 8;
+    header.channelCount = *pos++;
+    header.hasTotal = *pos++;
+    header.payloadSize = GetInt(pos, 4);        pos += 4;
+
+    if (header.channelCount > SCALE_MAX_CHANNELS) ThrowCorrupted("too many channels");
+    size_t columnCount = header.channelCount + header.hasTotal;
+
+    for (size_t column = 0; column < columnCount; column++)
+    {
+        ArchiveColumn& archiveColumn = header.columns[column];
+
+        // Name and unit, each prefixed with its size
+        for (char* text : {archiveColumn.name, archiveColumn.unit})
+        {
+            size_t textLimit = text == archiveColumn.name ? SCALE_NAME_SIZE : SCALE_UNIT_SIZE;
+            if (pos >= end || *pos >= textLimit || end - pos - 1 < *pos) ThrowCorrupted("bad column name");
+            std::memcpy(text, pos + 1, *pos);
+            text[*pos] = 0;
+            pos += 1 + *pos;
+        }
+
+        if (end - pos < 8) ThrowCorrupted("block header too small");
+        archiveColumn.minValue = GetInt(pos, 4);    pos += 4;
+        archiveColumn.maxValue = GetInt(pos, 4);    pos += 4;
+    }
+
+    // Timestamps, weights and VALID bits
+    uint64_t payloadSize = 0;
+    for (size_t column = 0; column < columnCount + 2; column++)
+    {
+        if (end - pos < 4) ThrowCorrupted("block header too small");
+        header.columnSizes[column] = GetInt(pos, 4);    pos += 4;
+        payloadSize += header.columnSizes[column];
+    }
+    if (payloadSize != header.payloadSize) ThrowCorrupted("column sizes do not add up");
+
+    // Every timestamp takes at least a byte, check before anything is sized by the count
+    if (header.readingCount > header.columnSizes[0] || header.readingCount > ARCHIVE_MAX_READINGS)
+        ThrowCorrupted("too many readings");
+
+    // Make sure the payload was written whole
+    off_t position = lseek(archiveFile, 0, SEEK_CUR);
+    struct stat archiveStat;
+    if (position < 0 || fstat(archiveFile, &archiveStat) != 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to find the archive size.");
+        throw std::runtime_error(errMsg);
+    }
+
+    return position + off_t(header.payloadSize) <= archiveStat.st_size;
+}
+
+/*
+ * The constructor instanciate an archive writer. Readings are appended
+ * to the archive, which is created if it does not exist, in blocks of
+ * the given number of readings.
+ */
+ReadingArchiveWriter::ReadingArchiveWriter(const char* archivePath, uint32_t blockSize)
+{
+    if (blockSize == 0 || blockSize > ARCHIVE_MAX_READINGS)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Archive blocks must hold between 1 and " + std::to_string(ARCHIVE_MAX_READINGS) + " readings.");
+        throw std::runtime_error(errMsg);
+    }
+
+    blockReadings = blockSize;
+    readingsWritten = 0;
+    bytesWritten = 0;
+    header.readingCount = 0;
+
+    // Allocate the columns up front for a whole block
+    timeColumn.reserve(blockReadings * ARCHIVE_VARINT_SIZE);
+    for (std::vector<uint8_t>& column : weightColumns) column.reserve(blockReadings * ARCHIVE_WEIGHT_SIZE + ARCHIVE_VARINT_SIZE);
+    validColumn.reserve((blockReadings + 7) / 8);
+
+    OpenArchive(archivePath);
+}
+
+/*
+ * Destructor for ReadingArchiveWriter writes the last block, even if
+ * it is not full, then closes the archive.
+ */
+ReadingArchiveWriter::~ReadingArchiveWriter()
+{
+    try
+    {
+        Flush();
+    }
+
+    catch(std::runtime_error e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
+    close(archiveFile);
+}
+
+/*
+ * Open the archive for appending. A new archive gets the file header,
+ * an existing one is checked and any block cut short by the writer
+ * stopping midway is removed, so new blocks follow the last whole one.
+ */
+void ReadingArchiveWriter::OpenArchive(const char* archivePath)
+{
+    archiveFile = open(archivePath, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (archiveFile < 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to open the archive: " + std::string(archivePath));
+        throw std::runtime_error(errMsg);
+    }
+
+    struct stat archiveStat;
+    fstat(archiveFile, &archiveStat);
+
+    // New archive, or not a file to append to (e.g. /dev/null)
+    if (!S_ISREG(archiveStat.st_mode) || archiveStat.st_size == 0)
+    {
+        uint8_t fileHeader[8] = {0};
+        std::memcpy(fileHeader, archiveMagic, sizeof(archiveMagic));
+        fileHeader[4] = ARCHIVE_VERSION;
+
+        if (write(archiveFile, fileHeader, sizeof(fileHeader)) != sizeof(fileHeader))
+        {
+            std::string errMsg = ErrorMsg(errno, "Failed to write the archive: " + std::string(archivePath));
+            throw std::runtime_error(errMsg);
+        }
+        bytesWritten += sizeof(fileHeader);
+        return;
+    }
+
+    uint8_t fileHeader[8];
+    if (ReadFully(archiveFile, fileHeader, sizeof(fileHeader)) < sizeof(fileHeader) ||
+        std::memcmp(fileHeader, archiveMagic, sizeof(archiveMagic)) != 0 || fileHeader[4] != ARCHIVE_VERSION)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Not a reading archive: " + std::string(archivePath));
+        throw std::runtime_error(errMsg);
+    }
+
+    // Skip over every whole block and cut off whatever follows
+    ArchiveBlockHeader existingHeader;
+    off_t blockStart = lseek(archiveFile, 0, SEEK_CUR);
+    while (ReadBlockHeader(archiveFile, existingHeader))
+        blockStart = lseek(archiveFile, existingHeader.payloadSize, SEEK_CUR);
+
+    if (blockStart < archiveStat.st_size && ftruncate(archiveFile, blockStart) != 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to remove a partial block from the archive: " + std::string(archivePath));
+        throw std::runtime_error(errMsg);
+    }
+}
+
+/*
+ * Append a reading to the current block. The block is written once it
+ * is full, or before a reading with different channels starts a new one.
+ * Readings without any weight are not kept. Nothing is allocated.
+ */
+void ReadingArchiveWriter::Append(const ScaleReading& reading)
+{
+    if (!reading.channelCount && !reading.hasTotal) return;
+
+    if (header.readingCount && !SameLayout(reading)) WriteBlock();
+    if (!header.readingCount) StartBlock(reading);
+
+    uint32_t row = header.readingCount;
+    int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(reading.timestamp.time_since_epoch()).count();
+
+    // The first timestamp is kept whole, the rest as their delta-of-delta
+    if (row == 0)
+        PutVarint(timeColumn, ZigZag(timeMs));
+    else
+    {
+        int64_t deltaMs = timeMs - lastTimeMs;
+        PutVarint(timeColumn, ZigZag(deltaMs - lastDeltaMs));
+        lastDeltaMs = deltaMs;
+    }
+    lastTimeMs = timeMs;
+    header.minTimeMs = std::min(header.minTimeMs, timeMs);
+    header.maxTimeMs = std::max(header.maxTimeMs, timeMs);
+
+    // Weights as their delta to the previous reading. A weight that holds
+    // is only counted, the count is written before the next change
+    size_t columnCount = header.channelCount + header.hasTotal;
+    for (size_t column = 0; column < columnCount; column++)
+    {
+        int32_t weight = column < header.channelCount ? reading.channels[column].rawValue : reading.total.rawValue;
+        int64_t delta = int64_t(weight) - lastWeights[column];
+
+        if (delta == 0)
+            unchangedWeights[column]++;
+        else
+        {
+            PutVarint(weightColumns[column], unchangedWeights[column]);
+            PutVarint(weightColumns[column], ZigZag(delta));
+            unchangedWeights[column] = 0;
+        }
+        lastWeights[column] = weight;
+
+        header.columns[column].minValue = std::min(header.columns[column].minValue, weight);
+        header.columns[column].maxValue = std::max(header.columns[column].maxValue, weight);
+    }
+
+    if (row % 8 == 0) validColumn.push_back(0);
+    validColumn.back() |= uint8_t(reading.valid) << (row % 8);
+
+    header.readingCount++;
+    readingsWritten++;
+
+    if (header.readingCount == blockReadings) WriteBlock();
+}
+
+/*
+ * Write the current block even if it is not full, and make sure
+ * everything written so far is on the disk.
+ */
+void ReadingArchiveWriter::Flush()
+{
+    WriteBlock();
+
+    // Devices such as /dev/null cannot be synced, there is nothing to lose
+    if (fdatasync(archiveFile) != 0 && errno != EINVAL)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to sync the archive.");
+        throw std::runtime_error(errMsg);
+    }
+}
+
+/*
+ * Check whether a reading has the same channels as the current block.
+ */
+bool ReadingArchiveWriter::SameLayout(const ScaleReading& reading)
+{
+    if (reading.channelCount != header.channelCount || reading.hasTotal != header.hasTotal) return false;
+
+    for (size_t column = 0; column < reading.channelCount; column++)
+    {
+        if (std::strcmp(reading.channels[column].name, header.columns[column].name) != 0) return false;
+        if (std::strcmp(reading.channels[column].unit, header.columns[column].unit) != 0) return false;
+    }
+
+    if (reading.hasTotal && std::strcmp(reading.total.unit, header.columns[reading.channelCount].unit) != 0) return false;
+
+    return true;
+}
+
+/*
+ * Start a new block with the channels of the reading.
+ */
+void ReadingArchiveWriter::StartBlock(const ScaleReading& reading)
+{
+    header.readingCount = 0;
+    header.minTimeMs = INT64_MAX;
+    header.maxTimeMs = INT64_MIN;
+    header.channelCount = reading.channelCount;
+    header.hasTotal = reading.hasTotal;
+
+    size_t columnCount = header.channelCount + header.hasTotal;
+    for (size_t column = 0; column < columnCount; column++)
+    {
+        const ScaleChannel& channel = column < header.channelCount ? reading.channels[column] : reading.total;
+        std::memcpy(header.columns[column].name, channel.name, sizeof(channel.name));
+        std::memcpy(header.columns[column].unit, channel.unit, sizeof(channel.unit));
+        header.columns[column].minValue = INT32_MAX;
+        header.columns[column].maxValue = INT32_MIN;
+
+        weightColumns[column].clear();
+        lastWeights[column] = 0;
+        unchangedWeights[column] = 0;
+    }
+
+    timeColumn.clear();
+    validColumn.clear();
+    lastTimeMs = 0;
+    lastDeltaMs = 0;
+}
+
+/*
+ * Write the current block, header and columns, in a single write.
+ */
+void ReadingArchiveWriter::WriteBlock()
+{
+    if (!header.readingCount) return;
+
+    size_t columnCount = header.channelCount + header.hasTotal;
+
+    // Weights that held until the end of the block
+    for (size_t column = 0; column < columnCount; column++)
+        if (unchangedWeights[column]) PutVarint(weightColumns[column], unchangedWeights[column]);
+
+    // Gather the columns after the header
+    iovec blockParts[ARCHIVE_MAX_COLUMNS + 3];
+    size_t partCount = 1;
+    header.payloadSize = 0;
+
+    std::vector<uint8_t>* columns[ARCHIVE_MAX_COLUMNS + 2];
+    columns[0] = &timeColumn;
+    for (size_t column = 0; column < columnCount; column++) columns[column + 1] = &weightColumns[column];
+    columns[columnCount + 1] = &validColumn;
+
+    for (size_t column = 0; column < columnCount + 2; column++)
+    {
+        header.columnSizes[column] = columns[column]->size();
+        header.payloadSize += columns[column]->size();
+        blockParts[partCount++] = {columns[column]->data(), columns[column]->size()};
+    }
+
+    // The header, prefixed with the block magic and its size
+    uint8_t headerBuffer[8 + ARCHIVE_HEADER_SIZE];
+    uint8_t* pos = headerBuffer + 8;
+    pos = PutInt(pos, header.readingCount, 4);
+    pos = PutInt(pos, header.minTimeMs, 8);
+    pos = PutInt(pos, header.maxTimeMs, 8);
+    pos = PutInt(pos, header.channelCount, 1);
+    pos = PutInt(pos, header.hasTotal, 1);
+    pos = PutInt(pos, header.payloadSize, 4);
+
+    for (size_t column = 0; column < columnCount; column++)
+    {
+        for (const char* text : {header.columns[column].name, header.columns[column].unit})
+        {
+            size_t textSize = std::strlen(text);
+            *pos++ = textSize;
+            std::memcpy(pos, text, textSize);
+            pos += textSize;
+        }
+        pos = PutInt(pos, uint32_t(header.columns[column].minValue), 4);
+        pos = PutInt(pos, uint32_t(header.columns[column].maxValue), 4);
+    }
+
+    for (size_t column = 0; column < columnCount + 2; column++)
+        pos = PutInt(pos, header.columnSizes[column], 4);
+
+    std::memcpy(headerBuffer, blockMagic, sizeof(blockMagic));
+    PutInt(headerBuffer + 4, pos - headerBuffer - 8, 4);
+    blockParts[0] = {headerBuffer, size_t(pos - headerBuffer)};
+
+    size_t blockSize = blockParts[0].iov_len + header.payloadSize;
+    ssize_t sentSize = writev(archiveFile, blockParts, partCount);
+    if (sentSize < 0 || size_t(sentSize) != blockSize)
+    {
+        std::string errMsg = ErrorMsg(sentSize < 0 ? errno : ENOSPC, "Failed to write a block to the archive.");
+        throw std::runtime_error(errMsg);
+    }
+
+    bytesWritten += blockSize;
+    header.readingCount = 0;
+}
+
+/*
+ * The constructor instanciate an archive reader and checks
+ * that the file is an archive.
+ */
+ReadingArchiveReader::ReadingArchiveReader(const char* archivePath)
+{
+    archiveFile = open(archivePath, O_RDONLY);
+    if (archiveFile < 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to open the archive: " + std::string(archivePath));
+        throw std::runtime_error(errMsg);
+    }
+
+    uint8_t fileHeader[8];
+    if (ReadFully(archiveFile, fileHeader, sizeof(fileHeader)) < sizeof(fileHeader) ||
+        std::memcmp(fileHeader, archiveMagic, sizeof(archiveMagic)) != 0 || fileHeader[4] != ARCHIVE_VERSION)
+    {
+        close(archiveFile);
+        std::string errMsg = ErrorMsg(EINVAL, "Not a reading archive: " + std::string(archivePath));
+        throw std::runtime_error(errMsg);
+    }
+
+    header.readingCount = 0;
+    header.payloadSize = 0;
+    payloadRead = true;
+}
+
+ReadingArchiveReader::~ReadingArchiveReader()
+{
+    close(archiveFile);
+}
+
+/*
+ * Move to the next block and read its header, skipping over the payload
+ * of the current block if it was not decoded. Returns false once there
+ * are no more whole blocks.
+ */
+bool ReadingArchiveReader::NextBlock()
+{
+    if (!payloadRead && lseek(archiveFile, header.payloadSize, SEEK_CUR) < 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to skip a block of the archive.");
+        throw std::runtime_error(errMsg);
+    }
+
+    payloadRead = false;
+    if (ReadBlockHeader(archiveFile, header)) return true;
+
+    // Nothing left to skip past
+    payloadRead = true;
+    return false;
+}
+
+void ReadingArchiveReader::ReadPayload()
+{
+    payload.resize(header.payloadSize);
+    if (ReadFully(archiveFile, payload.data(), payload.size()) < payload.size()) ThrowCorrupted("block cut short");
+    payloadRead = true;
+}
+
+/*
+ * Decode the columns of the current block. Each column is decoded on its
+ * own in passes over flat arrays: varints to values, zigzag back to signed,
+ * unchanged weights filled in and running sums back to weights and
+ * timestamps, so that the compiler can vectorise all but the sums.
+ */
+void ReadingArchiveReader::DecodeBlock()
+{
+    if (payloadRead)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Archive block was already decoded.");
+        throw std::runtime_error(errMsg);
+    }
+    ReadPayload();
+
+    size_t readingCount = header.readingCount;
+    size_t columnCount = header.channelCount + header.hasTotal;
+    const uint8_t* column = payload.data();
+
+    varints.resize(readingCount * 2 + 1);
+    timestamps.resize(readingCount);
+    weights.resize(readingCount * columnCount);
+
+    // Timestamps: the first whole, then delta-of-delta
+    if (DecodeVarints(column, header.columnSizes[0], varints.data(), readingCount) != readingCount)
+        ThrowCorrupted("timestamp column does not match the readings");
+    column += header.columnSizes[0];
+
+    int64_t* times = timestamps.data();
+    for (size_t row = 0; row < readingCount; row++) times[row] = UnZigZag(varints[row]);
+
+    if (readingCount)
+    {
+        int64_t firstTimeMs = times[0];
+        times[0] = 0;
+        for (size_t row = 1; row < readingCount; row++) times[row] += times[row-1];
+        for (size_t row = 1; row < readingCount; row++) times[row] += times[row-1];
+        for (size_t row = 0; row < readingCount; row++) times[row] += firstTimeMs;
+    }
+
+    // Weights: runs of unchanged weights, each followed by the delta to the
+    // previous reading, summed in unsigned to wrap like the writer
+    for (size_t weightColumn = 0; weightColumn < columnCount; weightColumn++)
+    {
+        size_t varintCount = DecodeVarints(column, header.columnSizes[weightColumn + 1], varints.data(), varints.size());
+        column += header.columnSizes[weightColumn + 1];
+
+        int32_t* values = weights.data() + weightColumn * readingCount;
+        size_t row = 0;
+        for (size_t indx = 0; indx < varintCount; indx += 2)
+        {
+            uint64_t unchanged = varints[indx];
+            if (unchanged > readingCount - row) ThrowCorrupted("weight column does not match the readings");
+            std::fill(values + row, values + row + unchanged, 0);
+            row += unchanged;
+
+            if (indx + 1 == varintCount) break;
+            if (row == readingCount) ThrowCorrupted("weight column does not match the readings");
+            values[row++] = int32_t(UnZigZag(varints[indx + 1]));
+        }
+        if (row != readingCount) ThrowCorrupted("weight column does not match the readings");
+
+        uint32_t weight = 0;
+        for (row = 0; row < readingCount; row++)
+        {
+            weight += uint32_t(values[row]);
+            values[row] = int32_t(weight);
+        }
+    }
+
+    // VALID bits, one per reading
+    size_t validSize = header.columnSizes[columnCount + 1];
+    if (validSize != (readingCount + 7) / 8) ThrowCorrupted("VALID column has the wrong size");
+    validBits.assign(column, column + validSize);
+}
+
+/*
+ * Fill a reading from a row of the decoded block, as it was parsed.
+ * The time it was received is not kept.
+ */
+void ReadingArchiveReader::Reading(size_t row, ScaleReading& reading)
+{
+    size_t readingCount = header.readingCount;
+
+    reading.channelCount = header.channelCount;
+    reading.hasTotal = header.hasTotal;
+    reading.valid = Valid(row);
+    reading.timestamp = std::chrono::system_clock::time_point(std::chrono::milliseconds(timestamps[row]));
+    reading.received = std::chrono::steady_clock::time_point();
+
+    size_t columnCount = header.channelCount + header.hasTotal;
+    for (size_t column = 0; column < columnCount; column++)
+    {
+        ScaleChannel& channel = column < header.channelCount ? reading.channels[column] : reading.total;
+        std::memcpy(channel.name, header.columns[column].name, sizeof(channel.name));
+        std::memcpy(channel.unit, header.columns[column].unit, sizeof(channel.unit));
+        channel.rawValue = weights[column * readingCount + row];
+        channel.value = std::max(channel.rawValue, 0);
+    }
+}
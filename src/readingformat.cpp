@@ -0,0 +1,171 @@
+#include <readingformat.h>
+
+/*
+ * An entry of the snapshot, either a weight or the VALID flag.
+ */
+struct SnapshotEntry
+{
+    const char*             name;
+    const ScaleChannel*     channel;
+};
+
+/*
+ * Collect the entries of a reading sorted by name, as they were when the
+ * reading was held as a JSON object. A later weight with the same name
+ * replaces an earlier one. The VALID flag is only present with a TOTAL.
+ * Returns the number of entries.
+ */
+static size_t SortedEntries(const ScaleReading& reading, SnapshotEntry* entries)
+{
+    size_t entryCount = 0;
+
+    for (int indx = 0; indx < reading.channelCount; indx++)
+        entries[entryCount++] = {reading.channels[indx].name, &reading.channels[indx]};
+
+    if (reading.hasTotal)
+    {
+        entries[entryCount++] = {reading.total.name, &reading.total};
+        entries[entryCount++] = {"VALID", NULL};
+    }
+
+    // Insertion sort, keeping the order of equal names
+    for (size_t indx = 1; indx < entryCount; indx++)
+    {
+        SnapshotEntry entry = entries[indx];
+        size_t pos = indx;
+        for (; pos > 0 && std::strcmp(entries[pos-1].name, entry.name) > 0; pos--)
+            entries[pos] = entries[pos-1];
+        entries[pos] = entry;
+    }
+
+    // Keep only the last of equal names
+    size_t uniqueCount = 0;
+    for (size_t indx = 0; indx < entryCount; indx++)
+    {
+        if (indx + 1 < entryCount && std::strcmp(entries[indx].name, entries[indx+1].name) == 0) continue;
+        entries[uniqueCount++] = entries[indx];
+    }
+
+    return uniqueCount;
+}
+
+/*
+ * Append formatted text to the buffer at the given length. Text past
+ * the end of the buffer is only counted. Returns the new length.
+ */
+static size_t AppendFormat(char* buffer, size_t bufferSize, size_t length, const char* format, ...)
+{
+    size_t pos = std::min(length, bufferSize);
+    va_list args;
+
+    va_start(args, format);
+    int written = vsnprintf(buffer + pos, bufferSize - pos, format, args);
+    va_end(args);
+
+    return length + std::max(written, 0);
+}
+
+/*
+ * Append a JSON string, escaped, to the buffer. Returns the new length.
+ */
+static size_t AppendJsonString(char* buffer, size_t bufferSize, size_t length, const char* text)
+{
+    length = AppendFormat(buffer, bufferSize, length, "\"");
+
+    for (; *text; text++)
+    {
+        unsigned char character = *text;
+        const char* escape = NULL;
+
+        switch (character)
+        {
+        case '"':  escape = "\\\""; break;
+        case '\\': escape = "\\\\"; break;
+        case '\b': escape = "\\b"; break;
+        case '\f': escape = "\\f"; break;
+        case '\n': escape = "\\n"; break;
+        case '\r': escape = "\\r"; break;
+        case '\t': escape = "\\t"; break;
+        }
+
+        if (escape != NULL)
+            length = AppendFormat(buffer, bufferSize, length, "%s", escape);
+        else if (character < 0x20)
+            length = AppendFormat(buffer, bufferSize, length, "\\u%04x", character);
+        else
+            length = AppendFormat(buffer, bufferSize, length, "%c", character);
+    }
+
+    return AppendFormat(buffer, bufferSize, length, "\"");
+}
+
+/*
+ * Format a reading as JSON into the buffer, without the heap. Each weight
+ * is assigned using its name as key, with the value and the unit assigned
+ * to the corresponding keys, followed by the VALID flag if there is a TOTAL.
+ * Returns the length of the JSON, which is cut short if it is bufferSize
+ * or more. The buffer is always terminated with a 0.
+ */
+size_t FormatReadingJson(const ScaleReading& reading, char* buffer, size_t bufferSize)
+{
+    SnapshotEntry entries[SCALE_MAX_CHANNELS + 2];
+    size_t entryCount = SortedEntries(reading, entries);
+    size_t length = 0;
+
+    length = AppendFormat(buffer, bufferSize, length, entryCount ? "{" : "null");
+
+    for (size_t indx = 0; indx < entryCount; indx++)
+    {
+        if (indx) length = AppendFormat(buffer, bufferSize, length, ",");
+        length = AppendJsonString(buffer, bufferSize, length, entries[indx].name);
+
+        if (entries[indx].channel == NULL)
+        {
+            length = AppendFormat(buffer, bufferSize, length, ":%s", reading.valid ? "true" : "false");
+            continue;
+        }
+
+        length = AppendFormat(buffer, bufferSize, length, ":{\"UNIT\":");
+        length = AppendJsonString(buffer, bufferSize, length, entries[indx].channel->unit);
+        length = AppendFormat(buffer, bufferSize, length, ",\"VALUE\":%d}", entries[indx].channel->value);
+    }
+
+    if (entryCount) length = AppendFormat(buffer, bufferSize, length, "}");
+
+    if (bufferSize) buffer[std::min(length, bufferSize - 1)] = 0;
+    return length;
+}
+
+/*
+ * Write a snapshot of the data with the time it was taken at,
+ * as printed on each interval boundary. Nothing is allocated.
+ */
+void WriteSnapshot(std::ostream& out, const ScaleReading& currentReading, const tm* currentTimeLocal)
+{
+    SnapshotEntry entries[SCALE_MAX_CHANNELS + 2];
+    size_t entryCount = SortedEntries(currentReading, entries);
+
+    // Convert tm to char* for printing
+    char timeChar[32];
+    std::strftime(timeChar, sizeof(timeChar), "Data at [%T]:", currentTimeLocal); 
+
+    out << timeChar << std::endl;
+
+    for (size_t indx = 0; indx < entryCount; indx++)
+    {
+        // For weight data, print the name and weight
+        if (entries[indx].channel != NULL)
+            out << entries[indx].name << ": " << entries[indx].channel->value << " " << entries[indx].channel->unit << std::endl;
+        // If it is the valid flag then print true or false
+        else
+            out << entries[indx].name << ": " << (currentReading.valid ? "TRUE" : "FALSE") << std::endl;
+    }
+
+    char jsonChar[READING_JSON_SIZE];
+    FormatReadingJson(currentReading, jsonChar, sizeof(jsonChar));
+
+    out << "--------------------------------------------------------" << std::endl;
+    out << "Raw JSON:" << std::endl;
+    out << jsonChar << std::endl;
+    out << "________________________________________________________" << std::endl;
+}
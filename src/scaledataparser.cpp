@@ -31,9 +31,39 @@ ScaleDataParser::ScaleDataParser(std::string path, int baud, int interval)
     serialPort = path;
     printInterval = interval;
     dataReady = false;
-
-    serialDataList.clear();
-    parsedData.clear();
+    realtime = false;
+    realtimePriority = 0;
+    threadError.clear();
+
+    framesParsed = 0;
+    latencySumUs = 0;
+    latencyMaxUs = 0;
+
+    reconnects = 0;
+    outageSumMs = 0;
+    outageMaxMs = 0;
+    reopensSeen = 0;
+    reopenSumUs = 0;
+    reopenMaxUs = 0;
+    frameGaps = 0;
+    gapSumMs = 0;
+    gapMaxMs = 0;
+    awaitingFrame = false;
+
+    boundariesPrinted = 0;
+    jitterSumUs = 0;
+    jitterMaxUs = 0;
+
+#ifdef SCALEPARSER_ALLOC_CHECK
+    boundariesWithData = 0;
+    warmupAllocations = 0;
+#endif
+
+    // Allocate the frame pool up front
+    framePool.resize(FRAME_POOL_SIZE);
+    poolHead = 0;
+    poolCount = 0;
+    framesOverrun = 0;
 
 }
 
@@ -47,20 +77,180 @@ ScaleDataParser::~ScaleDataParser()
 }
 
 /*
- * The function check if the data has been processed before collecting new data.
- * When reading from serial, waits for the start character '/' being read, before 
- * collecting the whole data. If the start character is not at the front,  
- * all data in front of it is purged.
- * The function  will keep reading until the closing character '\' has been received.
- * Data after the character, if any, is also purged. 
+ * Run the parser threads with SCHED_FIFO at the given priority, pinned to
+ * the given CPUs: collector, parser and output in that order, or none to
+ * leave them unpinned. In the event loop mode only the first CPU is used.
+ * Memory is also locked at startup so no page faults happen while running.
+ */
+void ScaleDataParser::EnableRealtime(int priority, std::vector<int> cpus)
+{
+    // Make sure the priority is in the SCHED_FIFO range
+    int minPriority = sched_get_priority_min(SCHED_FIFO);
+    int maxPriority = sched_get_priority_max(SCHED_FIFO);
+    if (priority < minPriority || priority > maxPriority)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Priority must be between " + std::to_string(minPriority) + " and " + std::to_string(maxPriority) + ". Input: " + std::to_string(priority));
+        throw std::runtime_error(errMsg);
+    }
+
+    // Make sure there is a CPU for each thread, and that they exist
+    if (!cpus.empty() && cpus.size() != 3)
+    {
+        std::string errMsg = ErrorMsg(EINVAL, "Three CPUs are needed: collector, parser and output. Input: " + std::to_string(cpus.size()));
+        throw std::runtime_error(errMsg);
+    }
+
+    // Only CPUs the process may run on, which a cpuset or container can limit
+    cpu_set_t allowedCpus;
+    CPU_ZERO(&allowedCpus);
+    if (sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus) != 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to get the CPUs the process may run on.");
+        throw std::runtime_error(errMsg);
+    }
+
+    for (int cpu : cpus)
+    {
+        if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowedCpus))
+        {
+            std::string errMsg = ErrorMsg(EINVAL, "CPU is not available to the process. Input: " + std::to_string(cpu));
+            throw std::runtime_error(errMsg);
+        }
+    }
+
+    realtime = true;
+    realtimePriority = priority;
+    threadCpus = cpus;
+}
+
+/*
+ * Append every parsed reading to the archive at the given path, created
+ * if it does not exist. The archive is opened here so any error is
+ * reported before the parser starts.
+ */
+void ScaleDataParser::EnableArchive(std::string path)
+{
+    archiveWriter.reset(new ReadingArchiveWriter(path.c_str()));
+    archivePath = path;
+}
+
+/*
+ * Lock all current and future memory so it is never paged out, and keep
+ * freed heap memory instead of returning it, so it does not have to be
+ * faulted in again. The frame pool is already filled in by the constructor,
+ * each thread faults in its own stack with PrefaultStack. Threads started
+ * from here on lock their whole stack, so they get a small one.
+ */
+void ScaleDataParser::LockMemory()
+{
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Failed to lock memory (needs root, CAP_IPC_LOCK or a higher RLIMIT_MEMLOCK, "
+                                             "the parser threads also lock " + std::to_string(REALTIME_STACK_SIZE / 1024) + " kB of stack each)");
+        throw std::runtime_error(errMsg);
+    }
+
+    pthread_attr_t threadAttr;
+    pthread_attr_init(&threadAttr);
+    pthread_attr_setstacksize(&threadAttr, REALTIME_STACK_SIZE);
+    int ret = pthread_setattr_default_np(&threadAttr);
+    pthread_attr_destroy(&threadAttr);
+    if (ret != 0)
+    {
+        std::string errMsg = ErrorMsg(ret, "Failed to set the stack size of the parser threads.");
+        throw std::runtime_error(errMsg);
+    }
+}
+
+/*
+ * Fault in the stack of the calling thread, so it does not page fault
+ * the first time it grows while running. The stores go through the
+ * volatile array so they are not optimised away.
+ */
+void ScaleDataParser::PrefaultStack()
+{
+    volatile char stackPrefault[64 * 1024];
+    for (size_t indx = 0; indx < sizeof(stackPrefault); indx++) stackPrefault[indx] = 0;
+}
+
+/*
+ * Set a thread to SCHED_FIFO at the realtime priority, and pin it
+ * to the given CPU unless it is negative.
+ */
+void ScaleDataParser::SetThreadRealtime(pthread_t thread, int cpu)
+{
+    if (cpu >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+
+        int ret = pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet);
+        if (ret != 0)
+        {
+            std::string errMsg = ErrorMsg(ret, "Failed to pin thread to CPU " + std::to_string(cpu));
+            throw std::runtime_error(errMsg);
+        }
+    }
+
+    sched_param schedParam = {};
+    schedParam.sched_priority = realtimePriority;
+
+    int ret = pthread_setschedparam(thread, SCHED_FIFO, &schedParam);
+    if (ret != 0)
+    {
+        std::string errMsg = ErrorMsg(ret, "Failed to set SCHED_FIFO priority (needs root or CAP_SYS_NICE)");
+        throw std::runtime_error(errMsg);
+    }
+}
+
+/*
+ * The function reads from serial and hands every complete message
+ * to the parser thread through the raw data list. If the port fails,
+ * e.g. the USB adapter is unplugged, it is reopened as soon as it is
+ * back while the other threads keep running with the latest reading.
  * NOTE: This function should be run on a separate thread.
  */
 void ScaleDataParser::CollectDataFromSerial()
 {
+    // Watch for the port coming back before opening it, so no change is missed
+    PortWatcher portWatcher(serialPort.c_str());
+
     // Create a SerialDriver instance
-    SerialDriver serialDriver(serialPort.c_str(), baudRate); 
+    std::unique_ptr<SerialDriver> serialDriver(new SerialDriver(serialPort.c_str(), baudRate));
+    bool portDelivered = false;
+    std::chrono::steady_clock::time_point nextRetry;
     bool terminateCalled = false;
 
+    // Hand every message completed by a read to the parser thread
+    std::chrono::system_clock::time_point timestampAt;
+    std::chrono::steady_clock::time_point receivedAt;
+    ScaleFramer framer([&](const char* frame, size_t size){
+        RecordFrameArrival(receivedAt);
+        // Lock the mutex
+        rawDataMutex.lock();
+        // If the parser is a whole pool behind, drop the message
+        if (poolCount == framePool.size())
+            framesOverrun++;
+        // Otherwise copy it into the next free slot
+        else
+        {
+            RawFrame& rawFrame = framePool[(poolHead + poolCount) % framePool.size()];
+            std::memcpy(rawFrame.data, frame, size);
+            rawFrame.size = size;
+            rawFrame.timestamp = timestampAt;
+            rawFrame.received = receivedAt;
+            poolCount++;
+        }
+        // Unlock the mutex
+        rawDataMutex.unlock();
+        // Wake the parser thread
+        rawDataCondition.notify_one();
+    });
+
     // Loop indefinitely until it is terminated
     while (!terminateCalled)
     {
@@ -68,164 +258,113 @@ void ScaleDataParser::CollectDataFromSerial()
         terminateCalled = terminateProgram;
         termFlagMutex.unlock();
 
-        std::string serialData = "";
-        bool dataAssembled = false;
-        bool startCollection = false;
-        std::string currentBuffer;
-        
-        // Collect data until a proper message has been collected
-        while (!dataAssembled && !terminateCalled)
+        // The port is lost, wait for it to be created again
+        if (!serialDriver)
         {
-            termFlagMutex.lock();
-            terminateCalled = terminateProgram;
-            termFlagMutex.unlock();
-
-            // Read from serial
-            currentBuffer = serialDriver.serialRead();
-
-            // Check for the "/" character
-            int startPos = currentBuffer.find_first_of('/');
-            // If found
-            if (startPos != std::string::npos)
-            {
-                // Clear the data (Done here case of corrupted data and you get 2 '/')
-                serialData.clear();
+            // Wait no longer than the next retry, which may already be due
+            std::chrono::milliseconds retryIn = std::chrono::ceil<std::chrono::milliseconds>(nextRetry - std::chrono::steady_clock::now());
+            bool portChanged = portWatcher.WaitForPort(std::clamp<int64_t>(retryIn.count(), 0, 100));
+            if (!portChanged && std::chrono::steady_clock::now() < nextRetry) continue;
+
+            nextRetry = std::chrono::steady_clock::now() + std::chrono::milliseconds(PORT_RETRY_MS);
+            ReopenPort([&]{ serialDriver.reset(new SerialDriver(serialPort.c_str(), baudRate)); }, portChanged);
+            continue;
+        }
 
-                // If there are data in front of the start character, purge
-                currentBuffer.erase(0, startPos);
-                startCollection = true;
-            }
-            
-            // Collect the data and check for closing character
-            if (startCollection)
-            {
-                // Check for the closing character
-                int endPos = currentBuffer.find_first_of('\\');
-                // If found
-                if (endPos != std::string::npos)
-                {
-                    // Purge all data after the character
-                    currentBuffer.erase(endPos+1);
-                    dataAssembled = true;
-                }
-                
-                // Append the buffer when all of the check has been completed
-                serialData.append(currentBuffer);
-            }
+        // Read from serial and assemble any complete messages
+        try
+        {
+            char dataBuffer[256];
+            size_t receiveSize = serialDriver->serialRead(dataBuffer, sizeof(dataBuffer), 100);
+            timestampAt = std::chrono::system_clock::now();
+            receivedAt = std::chrono::steady_clock::now();
+            framer.Feed(dataBuffer, receiveSize);
+            portDelivered = portDelivered || receiveSize > 0;
         }
 
-        // Once a proper message has been collected, lock the mutex
-        rawDataMutex.lock();
-        // Add the new data to the back of the vector
-        serialDataList.push_back(serialData);
-        // Unlock the mutex and repeat for the next message.
-        rawDataMutex.unlock();
+        catch(std::runtime_error e)
+        {
+            RecordPortLost(e.what());
+            serialDriver.reset();
+            // The rest of the frame being assembled is gone with the port
+            framer.Reset();
+            // Changes seen while the port was fine are of no use
+            portWatcher.PortChanged();
+
+            // Try again at once, unless the port failed before giving any data
+            nextRetry = std::chrono::steady_clock::now() + std::chrono::milliseconds(portDelivered ? 0 : PORT_RETRY_MS);
+            portDelivered = false;
+        }
     }
 }
 
 /*
- * Split lines of string using the '\n' character. Return
- * a vector by keep looping and collecting lines from the string.
- * If the string is empty then return an empty vector.
+ * Report a lost port and start measuring the outage.
  */
+void ScaleDataParser::RecordPortLost(const char* reason)
+{
+    std::cout << "WARNING: Serial port lost, waiting for it to return. " << reason << std::endl;
 
-std::vector<std::string> ScaleDataParser::SplitLines(std::string rawString)
+    portLostAt = std::chrono::steady_clock::now();
+    awaitingFrame = true;
+}
+
+/*
+ * Try to open the lost port again with the given function. If it opens,
+ * the outage is recorded, and if it was opened because the watcher saw
+ * it change, also the time it took to open from then. Returns true if
+ * the port was opened.
+ */
+bool ScaleDataParser::ReopenPort(std::function<void()> openPort, bool portChanged)
 {
-    std::vector<std::string> lineList;
-    std::string remainString = rawString;
-    // Find the first line brake
-    int newLinePos = remainString.find('\n');
+    std::chrono::steady_clock::time_point attemptAt = std::chrono::steady_clock::now();
 
-    bool terminateCalled = false;
-    
-    // If a line break found, loop until there are no longer any line break
-    while(newLinePos != std::string::npos && !terminateCalled)
+    try
     {
+        openPort();
+    }
 
-        termFlagMutex.lock();
-        terminateCalled = terminateProgram;
-        termFlagMutex.unlock();
-
-        // Get the line as substring
-        std::string line = remainString.substr(0, newLinePos);
-        // Check if line is not empty 
-        if (!line.empty())
-        {
-            // Remove carriage return
-            line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
-            // Add the line into the list
-            lineList.push_back(line);
-        }
-        
-        // Remove that line from the remaining string
-        remainString.erase(0, newLinePos+1);
-        // Find the next linebreak position
-        newLinePos = remainString.find('\n');
+    // Not back yet, or not usable yet, keep waiting
+    catch(std::runtime_error e)
+    {
+        return false;
     }
 
-    // Add the remaining string into the vector
-    if (!remainString.empty())
-        lineList.push_back(remainString);
+    std::chrono::steady_clock::time_point openedAt = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> outage = openedAt - portLostAt;
+    std::chrono::duration<double, std::micro> reopen = openedAt - attemptAt;
 
-    return lineList;
+    reconnects++;
+    outageSumMs += outage.count();
+    outageMaxMs = std::max(outageMaxMs, outage.count());
+
+    if (portChanged)
+    {
+        reopensSeen++;
+        reopenSumUs += reopen.count();
+        reopenMaxUs = std::max(reopenMaxUs, reopen.count());
+    }
+
+    std::cout << "Serial port reopened after " << outage.count() << " ms." << std::endl;
+    return true;
 }
 
 /*
- * Parses the raw data from a vector of line strings to JSON. 
- * The function finds the colon character ':' for assignment.
- * If the colon character does not exist, the line is skipped.
- * The parser then grab the name, the unit and the value of the data.
- * And saves them in the JSON format.
+ * Keep the time of the latest frame, and once the port is back, record
+ * the gap between the last frame before it was lost and the first after.
  */
-nlohmann::json ScaleDataParser::ParseDataToJson(std::vector<std::string> serialData)
+void ScaleDataParser::RecordFrameArrival(std::chrono::steady_clock::time_point received)
 {
-    nlohmann::json data;
-    int sum = 0;
-    // Loop through each line
-    for (std::string line : serialData)
+    if (awaitingFrame && lastFrameAt.time_since_epoch().count())
     {
-        // Delete all spaces from line
-        line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
-
-        // Find the separator (:)
-        int seperatorPos = line.find(':');
-        // Skip the line if not exist
-        if (seperatorPos == std::string::npos) continue;
-
-        // Note: Mass units are usually 1 or 2 characters
-        // The last character is the unit
-        
-        std::string unit = "";
-        unit.insert(unit.begin(), line.back());
-        // If the character before the unit is not a digit (i.e. a char)
-        if (!isdigit(line[line.size()-2]))
-            // Insert to the front of the unit
-            unit.insert(unit.begin(), line[line.size()-2]);
-
-        // Make a substring for the name
-        std::string name = line.substr(0, seperatorPos);
-        // Get the integer value of data
-        int value = atoi(line.substr(seperatorPos+1).c_str());
-
-        // If the value is negative, then report that scale is not calibrated and set value to 0 
-        if (value < 0)
-        {
-            std::cout << "WARNING: Negative weight found! Uncalibrated scale!. Name: " + name + " Value: " + std::to_string(value) << std::endl;
-            value = 0;
-        }
-        
-        // Assign the data using the name as key. The value and the unit is assigned to the corresponding keys
-        data[name] = {{"VALUE", value}, {"UNIT", unit}};
-        
-        // Sum up all value that is not the TOTAL
-        if (name != "TOTAL") sum += value;
-        // If it is the total then compares the sum to the value for the VALID flag
-        else
-            data["VALID"] = sum == value;
+        std::chrono::duration<double, std::milli> gap = received - lastFrameAt;
+        frameGaps++;
+        gapSumMs += gap.count();
+        gapMaxMs = std::max(gapMaxMs, gap.count());
     }
 
-    
-    return data;
+    awaitingFrame = false;
+    lastFrameAt = received;
 }
 
 /*
@@ -243,58 +382,92 @@ void ScaleDataParser::ProcessData()
         terminateCalled = terminateProgram;
         termFlagMutex.unlock();
 
-        // Lock mutex
-        rawDataMutex.lock();
-        // Get the size of the vector
-        int listSize = serialDataList.size();
-        // Unlock the mutex
-        rawDataMutex.unlock();
-        
-        // When there is data in the list
-        if (listSize)
-        {  
+        // Wait for data in the pool, waking regularly to check for termination
+        std::unique_lock<std::mutex> rawDataLock(rawDataMutex);
+        rawDataCondition.wait_for(rawDataLock, std::chrono::milliseconds(100), [this]{ return poolCount > 0; });
 
-            // Lock mutex
-            rawDataMutex.lock();
-            // Grab the first element
-            std::string serialData = serialDataList.front();
-            // Remove the first element
-            serialDataList.erase(serialDataList.begin());
+        // When there is data in the pool
+        if (poolCount)
+        {  
+            // Grab the first element, its slot is not reused until released
+            RawFrame& serialData = framePool[poolHead];
             // Unlock the mutex
-            rawDataMutex.unlock();
+            rawDataLock.unlock();
 
             // Further processing is safe here.
-            std::vector<std::string> serialDataLines = SplitLines(serialData);
-            // Parse data to JSON format
-            nlohmann::json currentData = ParseDataToJson(serialDataLines);
-
-            // Lock the JSON data mutex
-            jsonDataMutex.lock();
+            ScaleReading currentData;
+            bool parsed = readingParser.Parse(serialData.data, serialData.size, currentData);
+            currentData.timestamp = serialData.timestamp;
+            currentData.received = serialData.received;
+
+            // Release the slot
+            rawDataLock.lock();
+            poolHead = (poolHead + 1) % framePool.size();
+            poolCount--;
+            rawDataLock.unlock();
+
+            if (!parsed) continue;
+            WarnNegativeWeights(currentData);
+            if (archiveWriter) archiveWriter->Append(currentData);
+
+            // Lock the reading mutex
+            readingMutex.lock();
             // Save the data
-            parsedData = currentData;
+            latestReading = currentData;
             // Set that data is ready
             dataReady = true;
-            // Unlock the JSON data mutex
-            jsonDataMutex.unlock();
+            // Unlock the reading mutex
+            readingMutex.unlock();
+
+            RecordFrameLatency(currentData.received);
         }
     }
     
 }
 
 /*
- * Print the data every n seconds. The function get current time and divide it by 
- * the interval time. If modulo = 0 then print
+ * If a weight is negative, then report that scale is not calibrated.
+ * The parser has already set its value to 0.
+ */
+void ScaleDataParser::WarnNegativeWeights(const ScaleReading& reading)
+{
+    for (int indx = 0; indx < reading.channelCount; indx++)
+    {
+        const ScaleChannel& channel = reading.channels[indx];
+        if (channel.rawValue < 0)
+            std::cout << "WARNING: Negative weight found! Uncalibrated scale!. Name: " << channel.name << " Value: " << channel.rawValue << std::endl;
+    }
+
+    if (reading.hasTotal && reading.total.rawValue < 0)
+        std::cout << "WARNING: Negative weight found! Uncalibrated scale!. Name: " << reading.total.name << " Value: " << reading.total.rawValue << std::endl;
+}
+
+/*
+ * Record the time it took from reading a complete message to
+ * having its parsed data available for printing.
+ */
+void ScaleDataParser::RecordFrameLatency(std::chrono::steady_clock::time_point received)
+{
+    std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - received;
+
+    framesParsed++;
+    latencySumUs += latency.count();
+    latencyMaxUs = std::max(latencyMaxUs, latency.count());
+}
+
+/*
+ * Print the data every n seconds. The function sleeps until the next second
+ * which is divisible by the interval time, then prints the latest data.
  * Note: Should be run on a separate thread.
  */
 
 void ScaleDataParser::PrintData()
 {
-    time_t previousTime;
-    tm *currentTimeLocal;
-    bool waitMessagePrinted = false;
-
+    time_t nextBoundary = NextPrintBoundary(time(NULL));
     bool terminateCalled = false;
 
+    std::cout << "Waiting for data..." << std::endl;
+
     // Loop indefinitely until it is terminated
     while (!terminateCalled)
     {
@@ -302,83 +475,205 @@ void ScaleDataParser::PrintData()
         terminateCalled = terminateProgram;
         termFlagMutex.unlock();
 
-        // Lock the JSON data mutex
-        jsonDataMutex.lock();
+        if (!SleepUntilBoundary(nextBoundary)) continue;
+
+        RecordBoundaryJitter(nextBoundary);
+
+        // Lock the reading mutex
+        readingMutex.lock();
         bool dataAvailable = dataReady;
-        jsonDataMutex.unlock();
+        // Make a copy of the data
+        ScaleReading currentData = latestReading;
+        // Unlock the reading mutex
+        readingMutex.unlock();
 
         // If data is available
         if (dataAvailable)
         {
-            // Get the current time
-            time_t currentTime = time(NULL);
+            // Get the time in the tm struct
+            tm boundaryLocal;
+            localtime_r(&nextBoundary, &boundaryLocal);
 
-            // Make sure time is returned
-            if (currentTime == -1)
-            {
-                std::string errMsg = ErrorMsg(errno, "Could not get time...");
-                throw std::runtime_error(errMsg);
-            }
+            PrintSnapshot(currentData, &boundaryLocal);
+        }
 
-            // Only print if it is a new timestamp
-            if (currentTime == previousTime) continue;
-            // Get the time in the tm struct
-            currentTimeLocal = localtime(&currentTime);
+        // time() can lag the clock the boundary was reached on, never go back
+        nextBoundary = NextPrintBoundary(std::max(time(NULL), nextBoundary));
+    }
+}
 
-            // Check to see if the second is divisible by the interval
-            if(currentTimeLocal->tm_sec % printInterval == 0)
-            {
-                // Lock the JSON data mutex
-                jsonDataMutex.lock();
-                // Make a copy of the data
-                nlohmann::json currentData = parsedData;
-                // Unlock the JSON data mutex
-                jsonDataMutex.unlock();
+/*
+ * Print a snapshot of the data with the time it was taken at.
+ */
+void ScaleDataParser::PrintSnapshot(const ScaleReading& currentReading, tm* currentTimeLocal)
+{
+    WriteSnapshot(std::cout, currentReading, currentTimeLocal);
 
-                // Convert tm to char* for printing
-                char timeChar[32];
-                int ret = std::strftime(timeChar, sizeof(timeChar), "Data at [%T]:", currentTimeLocal); 
+#ifdef SCALEPARSER_ALLOC_CHECK
+    CheckAllocations();
+#endif
+}
 
-                std::cout << timeChar << std::endl;
+#ifdef SCALEPARSER_ALLOC_CHECK
+/*
+ * Allocation check build only. The first boundaries printed with data
+ * are the warm-up, after that the heap must not be used anymore. On every
+ * later boundary the allocations since the warm-up and the resident set
+ * size are printed, so they can be followed over a long run.
+ */
+void ScaleDataParser::CheckAllocations()
+{
+    boundariesWithData++;
 
-                for (auto& [key, val] : currentData.items())
-                {
-                    // For weight data, print the name and weight
-                    if (key != "VALID")
-                    {
-                        std::string name = key;
-                        int value = val["VALUE"];
-                        std::string unit = val["UNIT"];
-                        std::cout << name << ": " << std::to_string(value) + " " + unit << std::endl; 
-                    }
-                    // If it is the valid flag then print true or false
-                    else
-                    {
-                        std::string name = key;
-                        std::string value = val ? "TRUE" : "FALSE";
-                        std::cout << name << ": " << value << std::endl;
-                    }
-                        
-                }
-                std::cout << "--------------------------------------------------------" << std::endl;
-                std::cout << "Raw JSON:" << std::endl;
-                std::cout << currentData << std::endl;
-                std::cout << "________________________________________________________" << std::endl;
-            }
+    if (boundariesWithData == ALLOC_CHECK_WARMUP)
+        warmupAllocations = AllocationCount();
+    else if (boundariesWithData > ALLOC_CHECK_WARMUP)
+    {
+        std::cout << "Soak: frames " << framesParsed << " | allocations after warm-up " << AllocationCount() - warmupAllocations;
+        std::cout << " | RSS " << ResidentSetKb() << " kB" << std::endl;
+    }
+}
 
-            // Update the clock
-            previousTime = currentTime;
-        }
+/*
+ * Allocation check build only. Fail the run if the heap was used after
+ * the warm-up, or if the run was too short to finish the warm-up.
+ */
+void ScaleDataParser::VerifyAllocations()
+{
+    if (boundariesWithData < ALLOC_CHECK_WARMUP)
+    {
+        std::string errMsg = ErrorMsg(EAGAIN, "Allocation check did not finish warming up, run for longer.");
+        throw std::runtime_error(errMsg);
+    }
 
-        // If data is not ready and message has not been printed
-        else if (!waitMessagePrinted)
-        {
-            // Print a message
-            std::cout << "Waiting for data..." << std::endl;
-            waitMessagePrinted = true;
-        }
-        
+    uint64_t allocations = AllocationCount() - warmupAllocations;
+    std::cout << "Allocations after warm-up: " << allocations << std::endl;
 
+    if (allocations > 0)
+    {
+        std::string errMsg = ErrorMsg(ENOMEM, "Heap was used after warm-up: " + std::to_string(allocations) + " allocations");
+        throw std::runtime_error(errMsg);
+    }
+}
+#endif
+
+/*
+ * Return the first second after the given time which falls on
+ * a print boundary, i.e. the second is divisible by the interval.
+ */
+time_t ScaleDataParser::NextPrintBoundary(time_t after)
+{
+    tm boundaryLocal;
+    time_t boundary = after + 1;
+
+    // The interval is at most 60, so this is at most a minute of steps
+    while (localtime_r(&boundary, &boundaryLocal) && boundaryLocal.tm_sec % printInterval != 0)
+        boundary++;
+
+    return boundary;
+}
+
+/*
+ * Sleep until the given boundary, waking regularly to check for
+ * termination. Returns true once the boundary has been reached.
+ */
+bool ScaleDataParser::SleepUntilBoundary(time_t boundary)
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    // Sleep at most 100ms at a time
+    timespec wakeTime = now;
+    wakeTime.tv_nsec += 100000000;
+    if (wakeTime.tv_nsec >= 1000000000)
+    {
+        wakeTime.tv_sec++;
+        wakeTime.tv_nsec -= 1000000000;
+    }
+    if (wakeTime.tv_sec >= boundary) wakeTime = {boundary, 0};
+
+    clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &wakeTime, NULL);
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec >= boundary;
+}
+
+/*
+ * Record how late the print is compared to the boundary it is for.
+ */
+void ScaleDataParser::RecordBoundaryJitter(time_t boundary)
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    double jitterUs = (now.tv_sec - boundary) * 1e6 + now.tv_nsec / 1e3;
+
+    boundariesPrinted++;
+    jitterSumUs += jitterUs;
+    jitterMaxUs = std::max(jitterMaxUs, jitterUs);
+}
+
+/*
+ * Print the frame statistics collected during the run: how many
+ * messages were parsed, the latency from reading a message to its data
+ * being available, how late each print was after its boundary,
+ * the context switches taken per message, and for every time the port
+ * was lost, how long until it was reopened and until frames came again.
+ */
+void ScaleDataParser::PrintStats(const rusage& startUsage)
+{
+    rusage endUsage;
+    getrusage(RUSAGE_SELF, &endUsage);
+
+    long voluntary = endUsage.ru_nvcsw - startUsage.ru_nvcsw;
+    long involuntary = endUsage.ru_nivcsw - startUsage.ru_nivcsw;
+    double perFrame = framesParsed ? double(voluntary + involuntary) / framesParsed : 0;
+    double averageUs = framesParsed ? latencySumUs / framesParsed : 0;
+    double averageJitterUs = boundariesPrinted ? jitterSumUs / boundariesPrinted : 0;
+
+    std::cout << "Frames parsed: " << framesParsed << " | Overrun: " << framesOverrun << std::endl;
+    std::cout << "Frame latency (us): avg " << averageUs << " | max " << latencyMaxUs << std::endl;
+    std::cout << "Boundary jitter (us): avg " << averageJitterUs << " | max " << jitterMaxUs;
+    std::cout << " | " << boundariesPrinted << " boundaries" << std::endl;
+    std::cout << "Context switches: " << voluntary << " voluntary | " << involuntary << " involuntary";
+    std::cout << " | " << perFrame << " per frame" << std::endl;
+    std::cout << "Reconnects: " << reconnects << " | outage (ms): avg " << (reconnects ? outageSumMs / reconnects : 0) << " max " << outageMaxMs;
+    std::cout << " | reopen (us): avg " << (reopensSeen ? reopenSumUs / reopensSeen : 0) << " max " << reopenMaxUs;
+    std::cout << " | frame gap (ms): avg " << (frameGaps ? gapSumMs / frameGaps : 0) << " max " << gapMaxMs << std::endl;
+}
+
+/*
+ * Write the last block of the archive, if there is one, and report
+ * how much was archived.
+ */
+void ScaleDataParser::CloseArchive()
+{
+    if (!archiveWriter) return;
+
+    archiveWriter->Flush();
+    std::cout << "Archived readings: " << archiveWriter->ReadingsWritten() << " | " << archiveWriter->BytesWritten();
+    std::cout << " bytes written to " << archivePath << std::endl;
+}
+
+/*
+ * Run one of the parser threads. An error cannot be thrown out of
+ * a thread, so it is kept for RunParser to throw and all the threads
+ * are stopped.
+ */
+void ScaleDataParser::RunThread(void (ScaleDataParser::*threadFunction)())
+{
+    try
+    {
+        if (realtime) PrefaultStack();
+        (this->*threadFunction)();
+    }
+
+    catch(std::runtime_error e)
+    {
+        termFlagMutex.lock();
+        // Keep the first error, it is the cause of any others
+        if (threadError.empty()) threadError = e.what();
+        terminateProgram = true;
+        termFlagMutex.unlock();
     }
 }
 
@@ -388,12 +683,209 @@ void ScaleDataParser::PrintData()
 
 void ScaleDataParser::RunParser()
 {
-    std::thread dataCollector(&ScaleDataParser::CollectDataFromSerial, this);
-    std::thread jsonParser(&ScaleDataParser::ProcessData, this);
-    std::thread dataLogger(&ScaleDataParser::PrintData, this);
+    if (realtime) LockMemory();
+
+    rusage startUsage;
+    getrusage(RUSAGE_SELF, &startUsage);
+
+    std::thread dataCollector;
+    std::thread jsonParser;
+    std::thread dataLogger;
+
+    // Stop the threads started so far before reporting an error
+    auto stopThreads = [&]{
+        termFlagMutex.lock();
+        terminateProgram = true;
+        termFlagMutex.unlock();
+
+        for (std::thread* thread : {&dataCollector, &jsonParser, &dataLogger})
+            if (thread->joinable()) thread->join();
+    };
+
+    try
+    {
+        dataCollector = std::thread(&ScaleDataParser::RunThread, this, &ScaleDataParser::CollectDataFromSerial);
+        jsonParser = std::thread(&ScaleDataParser::RunThread, this, &ScaleDataParser::ProcessData);
+        dataLogger = std::thread(&ScaleDataParser::RunThread, this, &ScaleDataParser::PrintData);
+    }
+
+    catch(std::system_error e)
+    {
+        stopThreads();
+        std::string errMsg = ErrorMsg(e.code().value(), realtime ? "Failed to start the parser threads, each locks " + std::to_string(REALTIME_STACK_SIZE / 1024) + " kB of stack "
+                                                                   "(needs root, CAP_IPC_LOCK or a higher RLIMIT_MEMLOCK)" : "Failed to start the parser threads.");
+        throw std::runtime_error(errMsg);
+    }
+
+    try
+    {
+        if (realtime)
+        {
+            SetThreadRealtime(dataCollector.native_handle(), threadCpus.empty() ? -1 : threadCpus[0]);
+            SetThreadRealtime(jsonParser.native_handle(), threadCpus.empty() ? -1 : threadCpus[1]);
+            SetThreadRealtime(dataLogger.native_handle(), threadCpus.empty() ? -1 : threadCpus[2]);
+        }
+    }
+
+    catch(std::runtime_error e)
+    {
+        stopThreads();
+        throw;
+    }
 
     dataCollector.join();
     jsonParser.join();
     dataLogger.join();
     std::cout << "Stopped all threads." << std::endl;
+    PrintStats(startUsage);
+    CloseArchive();
+
+    if (!threadError.empty()) throw std::runtime_error(threadError);
+
+#ifdef SCALEPARSER_ALLOC_CHECK
+    VerifyAllocations();
+#endif
+}
+
+/*
+ * Run the parser on a single thread. Instead of handing data between the
+ * collector, parser and printer threads, one loop waits on the serial port
+ * with poll() until data arrives or the next print boundary is due, then
+ * assembles, parses and prints in place. The output is the same as RunParser.
+ */
+void ScaleDataParser::RunParserEventLoop()
+{
+    if (realtime)
+    {
+        LockMemory();
+        PrefaultStack();
+        SetThreadRealtime(pthread_self(), threadCpus.empty() ? -1 : threadCpus[0]);
+    }
+
+    rusage startUsage;
+    getrusage(RUSAGE_SELF, &startUsage);
+
+    // Parse every reading on this thread as it is read
+    ScaleParser scaleParser([this](const ScaleReading& reading){
+        RecordFrameArrival(reading.received);
+        WarnNegativeWeights(reading);
+        if (archiveWriter) archiveWriter->Append(reading);
+        latestReading = reading;
+        dataReady = true;
+        RecordFrameLatency(reading.received);
+    });
+    // Watch for the port coming back before opening it, so no change is missed
+    PortWatcher portWatcher(serialPort.c_str());
+    scaleParser.AttachPort(serialPort.c_str(), baudRate);
+    pollfd serialPoll = {scaleParser.Descriptor(), POLLIN, 0};
+    pollfd watchPoll = {portWatcher.Descriptor(), POLLIN, 0};
+    bool portDelivered = false;
+    std::chrono::steady_clock::time_point nextRetry;
+
+    time_t nextBoundary = NextPrintBoundary(time(NULL));
+    bool terminateCalled = false;
+
+    std::cout << "Waiting for data..." << std::endl;
+
+    // Loop indefinitely until it is terminated
+    while (!terminateCalled)
+    {
+        termFlagMutex.lock();
+        terminateCalled = terminateProgram;
+        termFlagMutex.unlock();
+
+        // Wait until the next boundary, waking regularly to check for termination
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        long timeoutMs = (nextBoundary - now.tv_sec) * 1000 - now.tv_nsec / 1000000 + 1;
+        timeoutMs = std::clamp(timeoutMs, 0L, 100L);
+
+        // Wait on the port, or while it is lost, on the watcher for its return
+        // but no longer than the next retry, which may already be due
+        bool portAttached = scaleParser.Descriptor() >= 0;
+        if (!portAttached)
+        {
+            std::chrono::milliseconds retryIn = std::chrono::ceil<std::chrono::milliseconds>(nextRetry - std::chrono::steady_clock::now());
+            timeoutMs = std::clamp<long>(retryIn.count(), 0L, timeoutMs);
+        }
+        pollfd& activePoll = portAttached ? serialPoll : watchPoll;
+        int ready = poll(&activePoll, 1, timeoutMs);
+
+        // Interrupted by a signal, go back and check for termination
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0)
+        {
+            std::string errMsg = ErrorMsg(errno, "Waiting on serial port failed!");
+            throw std::runtime_error(errMsg);
+        }
+
+        if (portAttached)
+        {
+            try
+            {
+                // Data available, parse every message completed by this read
+                bool dataRead = ready > 0 && scaleParser.ReadPort();
+                portDelivered = portDelivered || dataRead;
+
+                // Hung up with nothing left to read, it would only spin from here
+                if (ready > 0 && !dataRead && (serialPoll.revents & (POLLHUP | POLLERR)))
+                {
+                    std::string errMsg = ErrorMsg(EIO, "Serial port hung up!");
+                    throw std::runtime_error(errMsg);
+                }
+            }
+
+            catch(std::runtime_error e)
+            {
+                RecordPortLost(e.what());
+                scaleParser.DetachPort();
+                // Changes seen while the port was fine are of no use
+                portWatcher.PortChanged();
+
+                // Try again at once, unless the port failed before giving any data
+                nextRetry = std::chrono::steady_clock::now() + std::chrono::milliseconds(portDelivered ? 0 : PORT_RETRY_MS);
+                portDelivered = false;
+            }
+        }
+        else
+        {
+            // Reopen the port once it changed, or now and then in case that was missed
+            bool portChanged = ready > 0 && portWatcher.PortChanged();
+            if (portChanged || std::chrono::steady_clock::now() >= nextRetry)
+            {
+                nextRetry = std::chrono::steady_clock::now() + std::chrono::milliseconds(PORT_RETRY_MS);
+                if (ReopenPort([&]{ scaleParser.AttachPort(serialPort.c_str(), baudRate); }, portChanged))
+                    serialPoll.fd = scaleParser.Descriptor();
+            }
+        }
+
+        // Get the current time, from the same clock as the poll timeout
+        if (clock_gettime(CLOCK_REALTIME, &now) != 0)
+        {
+            std::string errMsg = ErrorMsg(errno, "Could not get time...");
+            throw std::runtime_error(errMsg);
+        }
+        time_t currentTime = now.tv_sec;
+
+        // Print once the boundary is reached
+        if (currentTime >= nextBoundary)
+        {
+            RecordBoundaryJitter(nextBoundary);
+
+            tm boundaryLocal;
+            localtime_r(&nextBoundary, &boundaryLocal);
+
+            if (dataReady) PrintSnapshot(latestReading, &boundaryLocal);
+
+            nextBoundary = NextPrintBoundary(currentTime);
+        }
+    }
+
+    std::cout << "Stopped event loop." << std::endl;
+    PrintStats(startUsage);
+    CloseArchive();
+
+#ifdef SCALEPARSER_ALLOC_CHECK
+    VerifyAllocations();
+#endif
 }
@@ -0,0 +1,92 @@
+#include <scaleframer.h>
+
+/*
+ * The constructor instanciate a framer which calls the provided
+ * callback with every complete frame.
+ */
+ScaleFramer::ScaleFramer(FrameCallback callback)
+{
+    frameCallback = callback;
+    frameBuffer.reserve(SCALE_MAX_FRAME_SIZE);
+    frameStarted = false;
+    framesAssembled = 0;
+    framesDropped = 0;
+}
+
+/*
+ * Assemble frames from a chunk of serial data. Waits for the start 
+ * character '/' before collecting the data. Data in front of it is purged,
+ * and a second start character restarts the frame (corrupted data).
+ * The frame is complete once the closing character '\' has been received.
+ * A chunk may end part way through a frame, in which case it is carried
+ * over to the next call, or hold several frames, which are all passed on.
+ * The frame given to the callback is only valid during the call.
+ */
+void ScaleFramer::Feed(const char* data, size_t size)
+{
+    const char* end = data + size;
+
+    while (data < end)
+    {
+        // Find the start character, or either character once collection started
+        const char* delim = data;
+        while (delim < end && *delim != '/' && !(frameStarted && *delim == '\\')) delim++;
+
+        // If not found, keep the rest when collecting, otherwise purge it
+        if (delim == end)
+        {
+            if (frameStarted) Append(data, end - data);
+            break;
+        }
+
+        // Start character, (re)start the frame
+        if (*delim == '/')
+        {
+            if (frameStarted) framesDropped++;
+            frameBuffer.assign(1, '/');
+            frameStarted = true;
+        }
+        // Closing character, the frame is complete
+        else
+        {
+            Append(data, delim + 1 - data);
+
+            // Unless it was dropped for being too large
+            if (frameStarted)
+            {
+                frameStarted = false;
+                framesAssembled++;
+                frameCallback(frameBuffer.data(), frameBuffer.size());
+                frameBuffer.clear();
+            }
+        }
+
+        data = delim + 1;
+    }
+}
+
+/*
+ * Append data to the frame being assembled. A frame this large is
+ * missing its closing character, so it is dropped instead. The buffer
+ * never grows past what was reserved.
+ */
+void ScaleFramer::Append(const char* data, size_t size)
+{
+    if (frameBuffer.size() + size > SCALE_MAX_FRAME_SIZE)
+    {
+        framesDropped++;
+        Reset();
+        return;
+    }
+
+    frameBuffer.append(data, size);
+}
+
+/*
+ * Discard any partially assembled frame.
+ */
+void ScaleFramer::Reset()
+{
+    frameBuffer.clear();
+    frameStarted = false;
+}
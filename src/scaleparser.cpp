@@ -0,0 +1,87 @@
+#include <scaleparser.h>
+
+/* 
+ * The constructor instanciate a parser which calls the provided
+ * callback with every reading parsed.
+ */
+ScaleParser::ScaleParser(ReadingCallback callback)
+    : framer([this](const char* frame, size_t size){ OnFrame(frame, size); })
+{
+    readingCallback = callback;
+    framesParsed = 0;
+}
+
+ScaleParser::~ScaleParser()
+{
+}
+
+/*
+ * Push a chunk of serial data into the parser. The callback is
+ * called once for every frame completed by this chunk.
+ */
+void ScaleParser::Push(const char* data, size_t size)
+{
+    reading.timestamp = std::chrono::system_clock::now();
+    reading.received = std::chrono::steady_clock::now();
+
+    framer.Feed(data, size);
+}
+
+/*
+ * Open and configure a serial port to read from. Any partially
+ * assembled frame from a previous source is discarded.
+ */
+void ScaleParser::AttachPort(const char* portPath, uint32_t baudRate)
+{
+    serialDriver.reset();
+    serialDriver.reset(new SerialDriver(portPath, baudRate));
+    framer.Reset();
+}
+
+/*
+ * Close the attached serial port, if any.
+ */
+void ScaleParser::DetachPort()
+{
+    serialDriver.reset();
+}
+
+/*
+ * Read whatever is available from the attached port without waiting and
+ * push it into the parser. Returns true if any data was read. Meant to be
+ * called once the descriptor is reported readable by poll() or similar.
+ */
+bool ScaleParser::ReadPort()
+{
+    if (!serialDriver)
+    {
+        std::string errMsg = ErrorMsg(ENODEV, "No serial port attached to the parser.");
+        throw std::runtime_error(errMsg);
+    }
+
+    char dataBuffer[256];
+    size_t receiveSize = serialDriver->serialReadAvailable(dataBuffer, sizeof(dataBuffer));
+
+    Push(dataBuffer, receiveSize);
+    return receiveSize > 0;
+}
+
+/*
+ * Return the descriptor of the attached port so it can be waited on,
+ * or -1 if there is none.
+ */
+int32_t ScaleParser::Descriptor()
+{
+    return serialDriver ? serialDriver->Descriptor() : -1;
+}
+
+/*
+ * Parse a complete frame and hand the reading to the callback.
+ */
+void ScaleParser::OnFrame(const char* frame, size_t size)
+{
+    if (!readingParser.Parse(frame, size, reading)) return;
+
+    framesParsed++;
+    readingCallback(reading);
+}
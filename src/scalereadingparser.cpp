@@ -0,0 +1,97 @@
+#include <scalereadingparser.h>
+
+/* 
+ * The constructor instanciate a reading parser.
+ */
+ScaleReadingParser::ScaleReadingParser()
+{
+    channelSum = 0;
+}
+
+/*
+ * Parses a frame into the provided reading. The frame is split into
+ * lines using the '\n' character and each line is parsed in turn.
+ * Returns true if any weight was found in the frame.
+ */
+bool ScaleReadingParser::Parse(const char* frame, size_t size, ScaleReading& reading)
+{
+    const char* end = frame + size;
+
+    reading.channelCount = 0;
+    reading.hasTotal = false;
+    reading.valid = false;
+    channelSum = 0;
+
+    // Loop through each line, the last one may not have a line break
+    while (frame < end)
+    {
+        const char* newLine = (const char*)std::memchr(frame, '\n', end - frame);
+        if (newLine == NULL) newLine = end;
+
+        ParseLine(frame, newLine - frame, reading);
+
+        frame = newLine + 1;
+    }
+
+    return reading.channelCount || reading.hasTotal;
+}
+
+/*
+ * Parses a single line. The function finds the colon character ':' for
+ * assignment. If the colon character does not exist, the line is skipped.
+ * The parser then grab the name, the unit and the value of the data.
+ * Weights are summed up until the TOTAL line, which is compared to the
+ * sum for the VALID flag.
+ */
+void ScaleReadingParser::ParseLine(const char* line, size_t size, ScaleReading& reading)
+{
+    // Copy the line without spaces and carriage returns
+    char cleanLine[SCALE_MAX_LINE_SIZE];
+    size_t length = 0;
+    for (size_t indx = 0; indx < size && length < sizeof(cleanLine) - 1; indx++)
+    {
+        if (line[indx] != ' ' && line[indx] != '\r')
+            cleanLine[length++] = line[indx];
+    }
+    cleanLine[length] = 0;
+
+    // Find the separator (:)
+    char* seperator = (char*)std::memchr(cleanLine, ':', length);
+    // Skip the line if not exist
+    if (seperator == NULL) return;
+    size_t seperatorPos = seperator - cleanLine;
+
+    ScaleChannel channel;
+
+    // Note: Mass units are usually 1 or 2 characters
+    // The last character is the unit. If the character before
+    // it is not a digit (i.e. a char), it is part of the unit too.
+    size_t unitSize = (length >= 2 && !isdigit(cleanLine[length-2])) ? 2 : 1;
+    std::memcpy(channel.unit, cleanLine + length - unitSize, unitSize);
+    channel.unit[unitSize] = 0;
+
+    // The name is everything before the separator
+    size_t nameSize = std::min(seperatorPos, sizeof(channel.name) - 1);
+    std::memcpy(channel.name, cleanLine, nameSize);
+    channel.name[nameSize] = 0;
+
+    // Get the integer value of data. If the value is negative then
+    // the scale is not calibrated and the value is reported as 0
+    channel.rawValue = atoi(seperator + 1);
+    channel.value = std::max(channel.rawValue, 0);
+
+    // Sum up all value that is not the TOTAL
+    if (std::strcmp(channel.name, "TOTAL") != 0)
+    {
+        if (reading.channelCount < SCALE_MAX_CHANNELS)
+            reading.channels[reading.channelCount++] = channel;
+        channelSum += channel.value;
+    }
+    // If it is the total then compares the sum to the value for the VALID flag
+    else
+    {
+        reading.total = channel;
+        reading.hasTotal = true;
+        reading.valid = channelSum == channel.value;
+    }
+}
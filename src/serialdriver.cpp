@@ -8,8 +8,18 @@ SerialDriver::SerialDriver(const char* portPath, uint32_t baudRate)
 {
     // Open the serial port
     OpenSerialPort(portPath);
-    // Configure the serial port
-    ConfigureSerialPort(baudRate);
+
+    // Configure the serial port, the destructor will not run if it fails
+    try
+    {
+        ConfigureSerialPort(baudRate);
+    }
+
+    catch(std::runtime_error e)
+    {
+        close(serialPort);
+        throw;
+    }
 }
 
 SerialDriver::~SerialDriver()
@@ -18,8 +28,6 @@ SerialDriver::~SerialDriver()
     tcsetattr(serialPort, TCSANOW, &oldSerialCfg);
     // Close the serial port
     close(serialPort);
-
-    std::cout << "Deleted serial driver instance." << std::endl;
 }
 
 /*
@@ -89,38 +97,58 @@ void SerialDriver::ConfigureSerialPort(uint32_t baudRate)
 }
 
 /*
- * Read from serial port and check from error
+ * Read from serial port into the provided buffer and check from error.
+ * Waits up to the given time for data, so the caller can regularly check
+ * whether to stop. Returns the number of bytes read, 0 if none arrived.
  */
-std::string SerialDriver::serialRead()
-{  
-    // Declare a buffer
-    char dataBuffer[256];
-    // Declare a size variable to handle return
-    int receiveSize = 0;
-    
-    bool terminateCalled = false;
-    // While the buffer does not receive any information
-    while (!receiveSize && !terminateCalled)
+size_t SerialDriver::serialRead(char* dataBuffer, size_t bufferSize, int timeoutMs)
+{
+    // Wait for data instead of spinning
+    pollfd serialPoll = {serialPort, POLLIN, 0};
+    int ready = poll(&serialPoll, 1, timeoutMs);
+    if (ready < 0 && errno != EINTR)
     {
-        termFlagMutex.lock();
-        terminateCalled = terminateProgram;
-        termFlagMutex.unlock();
-        // Read from serial port
-        receiveSize = read(serialPort, &dataBuffer, sizeof(dataBuffer));
-        
-        // If read failed, throw an error
-        if (receiveSize < 0) 
-        {
-            std::string errMsg = ErrorMsg(errno, "Reading from serial port failed!");
-            throw std::runtime_error(errMsg);
-        }
+        std::string errMsg = ErrorMsg(errno, "Waiting on serial port failed!");
+        throw std::runtime_error(errMsg);
     }
-    // Set the last part as 0
-    dataBuffer[receiveSize] = 0;
-    
-    return std::string(dataBuffer);
+
+    // Read from serial port
+    size_t receiveSize = serialReadAvailable(dataBuffer, bufferSize);
+
+    // Hung up with nothing left to read, it would only spin from here
+    if (receiveSize == 0 && ready > 0 && (serialPoll.revents & (POLLHUP | POLLERR)))
+    {
+        std::string errMsg = ErrorMsg(EIO, "Serial port hung up!");
+        throw std::runtime_error(errMsg);
+    }
+
+    return receiveSize;
 }
 
+/*
+ * Read whatever is currently available from the serial port into the
+ * provided buffer without waiting. Returns the number of bytes read, 0 if
+ * there is nothing to read. Meant to be called once poll() reports the
+ * port as readable.
+ */
+size_t SerialDriver::serialReadAvailable(char* dataBuffer, size_t bufferSize)
+{
+    // Read from serial port
+    ssize_t receiveSize = read(serialPort, dataBuffer, bufferSize);
+
+    // Nothing there after all (spurious wakeup) or interrupted, not an error
+    if (receiveSize < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return 0;
+
+    // If read failed, throw an error
+    if (receiveSize < 0)
+    {
+        std::string errMsg = ErrorMsg(errno, "Reading from serial port failed!");
+        throw std::runtime_error(errMsg);
+    }
+
+    return receiveSize;
+}
 
 /* 
  * Using the long number recieved, convert to baud speed type. 
@@ -0,0 +1,221 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <ctime>
+
+#include <readingarchive.h>
+#include <readingformat.h>
+
+void PrintHelp()
+{
+    std::cout << "Export readings from a scale reading archive as JSON, one reading per line" << std::endl;
+    std::cout << "Usage: scaleexport [-h|--help]" << std::endl;
+    std::cout << "                   [-a|--archive <path>]" << std::endl;
+    std::cout << "                   [--from <time>] [--to <time, not included>]" << std::endl;
+    std::cout << "                   [-o|--output <path> [default: stdout]] [-s|--summary]" << std::endl;
+    std::cout << "Times are local, \"YYYY-MM-DD HH:MM:SS\" or \"YYYY-MM-DD\", or seconds since the epoch." << std::endl;
+}
+
+/*
+ * Parse a time given on the command line into milliseconds since the
+ * epoch. Returns false if it is not in any of the accepted forms.
+ */
+bool ParseTime(std::string text, int64_t& timeMs)
+{
+    tm timeLocal = {};
+    const char* end = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &timeLocal);
+    if (end == NULL || *end)
+    {
+        timeLocal = {};
+        end = strptime(text.c_str(), "%Y-%m-%d", &timeLocal);
+    }
+
+    if (end != NULL && !*end)
+    {
+        timeLocal.tm_isdst = -1;
+        timeMs = int64_t(mktime(&timeLocal)) * 1000;
+        return true;
+    }
+
+    char* numberEnd;
+    long long seconds = strtoll(text.c_str(), &numberEnd, 10);
+    if (text.empty() || *numberEnd) return false;
+
+    timeMs = seconds * 1000;
+    return true;
+}
+
+/*
+ * Format milliseconds since the epoch as local time with milliseconds.
+ */
+void FormatTime(int64_t timeMs, char* timeChar, size_t timeCharSize)
+{
+    time_t seconds = timeMs / 1000;
+    tm timeLocal;
+    localtime_r(&seconds, &timeLocal);
+
+    size_t timeSize = std::strftime(timeChar, timeCharSize, "%Y-%m-%d %H:%M:%S", &timeLocal);
+    snprintf(timeChar + timeSize, timeCharSize - timeSize, ".%03d", int(timeMs % 1000));
+}
+
+/*
+ * Write a reading as a line of JSON, its local time followed by
+ * the reading as printed by the parser.
+ */
+void WriteReadingLine(std::ostream& out, const ScaleReading& reading, int64_t timeMs)
+{
+    char timeChar[32];
+    FormatTime(timeMs, timeChar, sizeof(timeChar));
+
+    char jsonChar[READING_JSON_SIZE];
+    FormatReadingJson(reading, jsonChar, sizeof(jsonChar));
+
+    out << "{\"TIME\":\"" << timeChar << "\",\"READING\":" << jsonChar << "}\n";
+}
+
+/*
+ * Write the header of a block: its time range, readings and
+ * the range of every weight.
+ */
+void WriteBlockSummary(std::ostream& out, const ArchiveBlockHeader& header)
+{
+    char minTimeChar[32];
+    char maxTimeChar[32];
+    FormatTime(header.minTimeMs, minTimeChar, sizeof(minTimeChar));
+    FormatTime(header.maxTimeMs, maxTimeChar, sizeof(maxTimeChar));
+
+    out << "Block: " << header.readingCount << " readings | " << minTimeChar << " - " << maxTimeChar;
+    out << " | " << header.payloadSize << " bytes" << std::endl;
+
+    size_t columnCount = header.channelCount + header.hasTotal;
+    for (size_t column = 0; column < columnCount; column++)
+    {
+        const ArchiveColumn& archiveColumn = header.columns[column];
+        out << "    " << archiveColumn.name << ": " << archiveColumn.minValue << " - " << archiveColumn.maxValue;
+        out << " " << archiveColumn.unit << " | " << header.columnSizes[column + 1] << " bytes" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string archivePath = "";
+    std::string outputPath = "";
+    int64_t fromMs = INT64_MIN;
+    int64_t toMs = INT64_MAX;
+    bool summary = false;
+
+    // Loop through all the command line arguments
+    for (int indx = 1; indx < argc; indx++)
+    {
+        std::string currentArg = std::string(argv[indx]);
+
+        if (currentArg == "-h" || currentArg == "--help")
+        {
+            PrintHelp();
+            return 0;
+        }
+        else if (currentArg == "-s" || currentArg == "--summary")
+        {
+            summary = true;
+            continue;
+        }
+
+        // Every other flag takes a value, made sure that it was actually provided.
+        if (indx + 1 > argc-1)
+        {
+            std::cout << "Error: You did not provide a value for " << currentArg << std::endl;
+            PrintHelp();
+            return -1;
+        }
+        std::string value = std::string(argv[++indx]);
+
+        if (currentArg == "-a" || currentArg == "--archive")
+            archivePath = value;
+        else if (currentArg == "-o" || currentArg == "--output")
+            outputPath = value;
+        else if ((currentArg == "--from" && ParseTime(value, fromMs)) || (currentArg == "--to" && ParseTime(value, toMs)))
+            continue;
+        else
+        {
+            std::cout << "Error: Unknown argument or invalid value: " << currentArg << " " << value << std::endl;
+            PrintHelp();
+            return -1;
+        }
+    }
+
+    if (archivePath.empty())
+    {
+        std::cout << "Error: You did not provide a path to the archive." << std::endl;
+        PrintHelp();
+        return -1;
+    }
+
+    try
+    {
+        ReadingArchiveReader archiveReader(archivePath.c_str());
+
+        std::ofstream outputFile;
+        if (!outputPath.empty())
+        {
+            outputFile.open(outputPath);
+            if (!outputFile)
+            {
+                std::string errMsg = ErrorMsg(errno, "Failed to open the output file: " + outputPath);
+                throw std::runtime_error(errMsg);
+            }
+        }
+        std::ostream& out = outputPath.empty() ? std::cout : outputFile;
+
+        uint64_t blocks = 0;
+        uint64_t blocksDecoded = 0;
+        uint64_t readingsExported = 0;
+        ScaleReading reading;
+
+        while (archiveReader.NextBlock())
+        {
+            const ArchiveBlockHeader& header = archiveReader.Header();
+            blocks++;
+
+            // Skip blocks outside the range without decoding them
+            if (header.maxTimeMs < fromMs || header.minTimeMs >= toMs) continue;
+
+            if (summary)
+            {
+                WriteBlockSummary(out, header);
+                continue;
+            }
+
+            archiveReader.DecodeBlock();
+            blocksDecoded++;
+
+            const int64_t* timestamps = archiveReader.Timestamps();
+            for (size_t row = 0; row < header.readingCount; row++)
+            {
+                if (timestamps[row] < fromMs || timestamps[row] >= toMs) continue;
+
+                archiveReader.Reading(row, reading);
+                WriteReadingLine(out, reading, timestamps[row]);
+                readingsExported++;
+            }
+        }
+
+        // Make sure nothing was lost writing, e.g. to a full disk
+        out.flush();
+        if (!out)
+        {
+            std::string errMsg = ErrorMsg(errno, "Failed to write the export to " + (outputPath.empty() ? std::string("stdout") : outputPath));
+            throw std::runtime_error(errMsg);
+        }
+
+        if (!summary)
+            std::cerr << "Exported " << readingsExported << " readings, decoded " << blocksDecoded << " of " << blocks << " blocks" << std::endl;
+
+        return 0;
+    }
+
+    catch(std::runtime_error e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+}